@@ -15,6 +15,8 @@ DEFINE_PARAMETER(float, stillbornTrimmingThreshold, .25)
 DEFINE_PARAMETER(float, stillbornTrimmingDelay, 4)
 DEFINE_PARAMETER(uint, stillbornTrimmingMinDelay, 200)
 
+DEFINE_PARAMETER(uint, serializationThreads, 0)
+
 DEFINE_DEBUG_PARAMETER(bool, DEBUG_FULL_CONTINUOUS, true)
 DEFINE_DEBUG_PARAMETER(int, DEBUG_ENV_CRIT, 1)
 
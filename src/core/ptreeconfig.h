@@ -43,6 +43,9 @@ struct CFILE : public ConfigFile<CFILE> {
   /// How long to wait for before considering trimming a species
   DECLARE_PARAMETER(uint, stillbornTrimmingMinDelay)
 
+  /// Number of threads used to save/load trees (0 for all hardware threads)
+  DECLARE_PARAMETER(uint, serializationThreads)
+
   /// (Debug) selector for the species matching score computing type
   DECLARE_DEBUG_PARAMETER(bool, DEBUG_FULL_CONTINUOUS, true)
 
@@ -0,0 +1,425 @@
+#ifndef KGD_APOGET_ASYNCCALLBACKS_H
+#define KGD_APOGET_ASYNCCALLBACKS_H
+
+/*!
+ * \file asynccallbacks.h
+ *
+ * Contains the definition of the (optional) asynchronous dispatch layer for
+ * the tree callbacks.
+ *
+ * Events are copied into a bounded lock-free multi-producer/single-consumer
+ * ring buffer and delivered, in order, to the actual observer either by a
+ * dedicated thread or by whoever calls drain() (e.g. a QTimer in the GUI
+ * thread), so that slow observers no longer stall the simulation.
+ */
+
+#include <array>
+#include <chrono>
+#include <limits>
+#include <thread>
+
+#include "treetypes.h"
+
+namespace phylogeny {
+
+/// What producers do when the queue of an AsyncCallbacks is full
+enum class BackPressure {
+  BLOCK,        ///< Wait for a free slot (lossless)
+  DROP_COALESCE ///< Merge step events into a pending one, drop the others
+};
+
+namespace _details {
+
+/// Bounded lock-free multi-producer/single-consumer queue (Vyukov's bounded
+/// queue restricted to a single consumer)
+template <typename T>
+class MPSCQueue {
+public:
+  /// Creates a queue holding at least \p capacity items (rounded up to a power
+  /// of two)
+  explicit MPSCQueue (size_t capacity) {
+    size_t c = 2;
+    while (c < capacity) c <<= 1;
+    _cells = std::make_unique<Cell[]>(c);
+    _mask = c - 1;
+    for (size_t i=0; i<c; i++)
+      _cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  /// Moves \p v into the queue (any thread)
+  /// \returns false if the queue was full
+  bool tryPush (T &&v) {
+    size_t pos = _head.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &c = _cells[pos & _mask];
+      size_t seq = c.seq.load(std::memory_order_acquire);
+      auto diff = std::intptr_t(seq) - std::intptr_t(pos);
+      if (diff == 0) {
+        if (_head.compare_exchange_weak(pos, pos+1,
+                                        std::memory_order_relaxed)) {
+          c.value = std::move(v);
+          c.seq.store(pos+1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0)
+        return false;
+      else
+        pos = _head.load(std::memory_order_relaxed);
+    }
+  }
+
+  /// Moves the oldest item into \p v (consumer thread only)
+  /// \returns false if the queue was empty
+  bool tryPop (T &v) {
+    Cell &c = _cells[_tail & _mask];
+    size_t seq = c.seq.load(std::memory_order_acquire);
+    if (std::intptr_t(seq) - std::intptr_t(_tail+1) < 0) return false;
+    v = std::move(c.value);
+    c.seq.store(_tail + _mask + 1, std::memory_order_release);
+    _tail++;
+    return true;
+  }
+
+private:
+  /// A slot and its sequence number
+  struct Cell {
+    std::atomic<size_t> seq;  ///< Position this slot is ready for
+    T value;                  ///< Stored item
+  };
+
+  std::unique_ptr<Cell[]> _cells;  ///< Storage
+  size_t _mask;                    ///< Capacity - 1
+
+  alignas(64) std::atomic<size_t> _head {0};  ///< Next position to write
+  alignas(64) size_t _tail = 0;               ///< Next position to read
+};
+
+} // end of namespace _details
+
+/// Dispatches the Callbacks_t events to \p TARGET asynchronously.
+///
+/// Every event is copied into a bounded lock-free queue (producers may be the
+/// concurrent insertion workers) and later delivered to the target in the
+/// order it was emitted. When the queue is full, producers either wait
+/// (BackPressure::BLOCK) or, with BackPressure::DROP_COALESCE, merge step
+/// events into a single pending one (deltas are accumulated, only the latest
+/// living set is kept) and drop the others (see dropped()). Coalesced steps
+/// are delivered once the queue has been emptied, i.e. possibly after some of
+/// the events that followed them.
+///
+/// \warning Events reach the target after the fact: observers querying the
+/// tree must synchronize with the simulation themselves.
+///
+/// To use it, derive the tree's Callbacks_t from it, e.g.:
+/// \code
+/// template <>
+/// struct phylogeny::Callbacks_t<MyTree>
+///   : phylogeny::AsyncCallbacks<MyObserver> {
+///   using AsyncCallbacks::AsyncCallbacks;
+/// };
+/// \endcode
+///
+/// \tparam TARGET any type providing the Callbacks_t member functions
+template <typename TARGET>
+class AsyncCallbacks {
+public:
+  /// Who delivers the events
+  enum class Delivery {
+    THREAD, ///< A dedicated consumer thread
+    MANUAL  ///< A single external consumer, through drain()
+  };
+
+  /// Default number of queued events
+  static constexpr size_t DEFAULT_CAPACITY = 1 << 14;
+
+  /// Delivers events to \p target with given \p capacity, back-pressure
+  /// \p policy and \p delivery mode.
+  /// \warning With Delivery::MANUAL and BackPressure::BLOCK, the thread
+  /// calling drain() must not be one of the producers
+  AsyncCallbacks (TARGET &target, size_t capacity = DEFAULT_CAPACITY,
+                  BackPressure policy = BackPressure::BLOCK,
+                  Delivery delivery = Delivery::THREAD)
+    : _target(target), _queue(capacity), _policy(policy),
+      _delivery(delivery) {
+    if (_delivery == Delivery::THREAD)
+      _thread = std::thread(&AsyncCallbacks::consumerLoop, this);
+  }
+
+  /// Delivers the remaining events and stops the consumer thread (if any)
+  ~AsyncCallbacks (void) {
+    if (_delivery == Delivery::THREAD) {
+      _stop = true;
+      _thread.join();
+    } else
+      drain();
+
+    delete _pendingDelta.load();
+    delete _pendingStep.load();
+  }
+
+  /// Dispatchers hold a thread
+  AsyncCallbacks (const AsyncCallbacks&) = delete;
+
+  /// Dispatchers hold a thread
+  AsyncCallbacks& operator= (const AsyncCallbacks&) = delete;
+
+  /// \returns the observer receiving the events
+  TARGET& target (void) {
+    return _target;
+  }
+
+  /// \returns the number of events dropped under BackPressure::DROP_COALESCE
+  size_t dropped (void) const {
+    return _dropped.load(std::memory_order_relaxed);
+  }
+
+  /// Delivers at most \p max queued events, on the calling thread.
+  /// Must only be called by a single consumer (and only in Delivery::MANUAL
+  /// mode, the dedicated thread being the consumer otherwise)
+  /// \returns the number of delivered events
+  size_t drain (size_t max = std::numeric_limits<size_t>::max()) {
+    size_t n = 0;
+    Event e;
+    while (n < max && _queue.tryPop(e)) {
+      deliver(e);
+      _consumed.fetch_add(1, std::memory_order_release);
+      n++;
+    }
+    if (n < max)  n += deliverCoalesced();
+    return n;
+  }
+
+  /// Waits until all events emitted so far have been delivered (drains them
+  /// directly in Delivery::MANUAL mode)
+  void flush (void) {
+    if (_delivery == Delivery::MANUAL) {
+      drain();
+      return;
+    }
+
+    size_t target = _produced.load(std::memory_order_acquire);
+    while (_consumed.load(std::memory_order_acquire) < target
+           || _pendingDelta.load() || _pendingStep.load() || _inFlight.load())
+      std::this_thread::yield();
+  }
+
+  /// Queues a copy of \p living
+  /// \copydetails Callbacks_t::onStepped
+  void onStepped (uint step, const LivingSet &living) {
+    // Stay behind coalesced deltas
+    if (_policy == BackPressure::DROP_COALESCE
+        && (_pendingStep.load() || _pendingDelta.load())) {
+      coalesce(step, living);
+      return;
+    }
+
+    Event e (Event::STEPPED);
+    e.step = step;
+    e.living = std::make_unique<LivingSet>(living);
+    if (!push(e)) coalesce(step, *e.living);
+  }
+
+  /// Queues a copy of \p delta
+  /// \copydetails Callbacks_t::onSteppedDelta
+  void onSteppedDelta (uint step, const LivingDelta &delta) {
+    if (_policy == BackPressure::DROP_COALESCE && _pendingDelta.load()) {
+      coalesce(step, delta);
+      return;
+    }
+
+    Event e (Event::STEPPED_DELTA);
+    e.step = step;
+    e.delta = std::make_unique<LivingDelta>(delta);
+    if (!push(e)) coalesce(step, *e.delta);
+  }
+
+  /// Queues the event
+  /// \copydetails Callbacks_t::onNewSpecies
+  void onNewSpecies (SID pid, SID sid) {
+    Event e (Event::NEW_SPECIES);
+    e.sids = { pid, sid, SID::INVALID };
+    pushOrDrop(e);
+  }
+
+  /// Queues the event
+  /// \copydetails Callbacks_t::onGenomeEntersEnveloppe
+  void onGenomeEntersEnveloppe (SID sid, GID gid) {
+    Event e (Event::GENOME_ENTERS);
+    e.sids[0] = sid;
+    e.gid = gid;
+    pushOrDrop(e);
+  }
+
+  /// Queues the event
+  /// \copydetails Callbacks_t::onGenomeLeavesEnveloppe
+  void onGenomeLeavesEnveloppe (SID sid, GID gid) {
+    Event e (Event::GENOME_LEAVES);
+    e.sids[0] = sid;
+    e.gid = gid;
+    pushOrDrop(e);
+  }
+
+  /// Queues the event
+  /// \copydetails Callbacks_t::onMajorContributorChanged
+  void onMajorContributorChanged (SID sid, SID oldMC, SID newMC) {
+    Event e (Event::MC_CHANGED);
+    e.sids = { sid, oldMC, newMC };
+    pushOrDrop(e);
+  }
+
+private:
+  /// A queued callback invocation
+  struct Event {
+    /// Which callback to invoke
+    enum Type : uint8_t {
+      STEPPED, STEPPED_DELTA, NEW_SPECIES, GENOME_ENTERS, GENOME_LEAVES,
+      MC_CHANGED
+    } type;
+
+    uint step;                  ///< Step (step events)
+    std::array<SID, 3> sids;    ///< Species identifiers (in callback order)
+    GID gid;                    ///< Genome identifier (enveloppe events)
+    std::unique_ptr<LivingSet> living;  ///< Alive species (STEPPED)
+    std::unique_ptr<LivingDelta> delta; ///< Living changes (STEPPED_DELTA)
+
+    /// Creates an event of type \p t
+    explicit Event (Type t = STEPPED) : type(t), step(0), gid(GID::INVALID) {
+      sids.fill(SID::INVALID);
+    }
+  };
+
+  /// A coalesced step event
+  template <typename T>
+  struct Pending {
+    uint step;  ///< Latest coalesced step
+    T data;     ///< Latest living set or accumulated deltas
+  };
+
+  /// Coalesced delta type
+  using PendingDelta = Pending<LivingDelta>;
+
+  /// Coalesced living set type
+  using PendingStep = Pending<LivingSet>;
+
+  TARGET &_target;  ///< Receives the events
+  _details::MPSCQueue<Event> _queue;  ///< Events waiting for delivery
+  const BackPressure _policy;   ///< What to do when the queue is full
+  const Delivery _delivery;     ///< Who delivers the events
+
+  /// Accumulated deltas waiting for delivery (DROP_COALESCE only)
+  std::atomic<PendingDelta*> _pendingDelta {nullptr};
+
+  /// Latest living set waiting for delivery (DROP_COALESCE only)
+  std::atomic<PendingStep*> _pendingStep {nullptr};
+
+  std::atomic<size_t> _produced {0};  ///< Number of queued events
+  std::atomic<size_t> _consumed {0};  ///< Number of delivered queued events
+  std::atomic<size_t> _dropped {0};   ///< Number of dropped events
+  std::atomic<bool> _inFlight {false};  ///< Whether coalesced events are being
+                                        ///  delivered
+
+  std::atomic<bool> _stop {false};  ///< Whether the consumer should terminate
+  std::thread _thread;              ///< Consumer thread (if any)
+
+  /// Queues \p e, waiting for a free slot under BackPressure::BLOCK
+  /// \returns false if the queue was full under BackPressure::DROP_COALESCE
+  bool push (Event &e) {
+    while (!_queue.tryPush(std::move(e))) {
+      if (_policy == BackPressure::DROP_COALESCE) return false;
+      std::this_thread::yield();
+    }
+    _produced.fetch_add(1, std::memory_order_release);
+    return true;
+  }
+
+  /// Queues \p e or drops it
+  void pushOrDrop (Event &e) {
+    if (!push(e)) _dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /// Merges \p delta into the pending deltas (only the stepping thread emits
+  /// step events, the consumer may concurrently take the pending ones)
+  void coalesce (uint step, const LivingDelta &delta) {
+    PendingDelta *p = _pendingDelta.exchange(nullptr);
+    if (!p)
+      p = new PendingDelta { step, delta };
+    else {
+      p->step = step;
+      merge(p->data.appeared, p->data.disappeared, delta.appeared);
+      merge(p->data.disappeared, p->data.appeared, delta.disappeared);
+    }
+    _pendingDelta.store(p);
+  }
+
+  /// Replaces the pending living set with \p living
+  void coalesce (uint step, const LivingSet &living) {
+    delete _pendingStep.exchange(new PendingStep { step, living });
+  }
+
+  /// Adds \p sids to \p into, unless they cancel out with \p opposite
+  static void merge (std::vector<SID> &into, std::vector<SID> &opposite,
+                     const std::vector<SID> &sids) {
+    for (SID sid: sids) {
+      auto it = std::find(opposite.begin(), opposite.end(), sid);
+      if (it != opposite.end())
+        opposite.erase(it);
+      else
+        into.push_back(sid);
+    }
+  }
+
+  /// Delivers the coalesced step events (deltas first, as the tree does)
+  /// \returns the number of delivered events
+  size_t deliverCoalesced (void) {
+    if (!_pendingDelta.load() && !_pendingStep.load()) return 0;
+
+    size_t n = 0;
+    _inFlight = true;
+    if (std::unique_ptr<PendingDelta> d {_pendingDelta.exchange(nullptr)}) {
+      _target.onSteppedDelta(d->step, d->data);
+      n++;
+    }
+    if (std::unique_ptr<PendingStep> s {_pendingStep.exchange(nullptr)}) {
+      _target.onStepped(s->step, s->data);
+      n++;
+    }
+    _inFlight = false;
+    return n;
+  }
+
+  /// Forwards \p e to the target
+  void deliver (const Event &e) {
+    switch (e.type) {
+    case Event::STEPPED:
+      _target.onStepped(e.step, *e.living);
+      break;
+    case Event::STEPPED_DELTA:
+      _target.onSteppedDelta(e.step, *e.delta);
+      break;
+    case Event::NEW_SPECIES:
+      _target.onNewSpecies(e.sids[0], e.sids[1]);
+      break;
+    case Event::GENOME_ENTERS:
+      _target.onGenomeEntersEnveloppe(e.sids[0], e.gid);
+      break;
+    case Event::GENOME_LEAVES:
+      _target.onGenomeLeavesEnveloppe(e.sids[0], e.gid);
+      break;
+    case Event::MC_CHANGED:
+      _target.onMajorContributorChanged(e.sids[0], e.sids[1], e.sids[2]);
+      break;
+    }
+  }
+
+  /// Consumer thread main loop: delivers events as they come, naps when idle
+  void consumerLoop (void) {
+    using namespace std::chrono_literals;
+    while (!_stop.load(std::memory_order_acquire))
+      if (drain() == 0) std::this_thread::sleep_for(50us);
+    drain();
+  }
+};
+
+} // end of namespace phylogeny
+
+#endif // KGD_APOGET_ASYNCCALLBACKS_H
@@ -0,0 +1,56 @@
+#include "binaryformat.h"
+
+namespace phylogeny {
+namespace binary {
+
+/// File signature
+static constexpr char MAGIC [4] = { 'A', 'P', 'T', 'B' };
+
+/// Byte-order marker (as written on the writer's architecture)
+static constexpr uint32_t ENDIANNESS = 0x01020304;
+
+Header Header::make (void) {
+  Header h {};
+  std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+  h.version = VERSION;
+  h.endianness = ENDIANNESS;
+  return h;
+}
+
+bool Header::valid (void) const {
+  return std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0
+      && version == VERSION && endianness == ENDIANNESS;
+}
+
+void Header::validate (void) const {
+  if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+    utils::doThrow<std::invalid_argument>("Not a binary phylogenetic tree");
+
+  if (endianness != ENDIANNESS)
+    utils::doThrow<std::invalid_argument>(
+      "Binary phylogenetic tree was written with a different byte order");
+
+  if (version != VERSION)
+    utils::doThrow<std::invalid_argument>(
+      "Binary phylogenetic tree has version ", version, " while only version ",
+      VERSION, " is supported");
+}
+
+bool isBinary (std::istream &is) {
+  char magic [sizeof(MAGIC)];
+  auto pos = is.tellg();
+  is.read(magic, sizeof(MAGIC));
+  bool ok = bool(is) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+  is.clear();
+  is.seekg(pos);
+  return ok;
+}
+
+void pad (std::ostream &os) {
+  static constexpr char zeros [8] {};
+  auto pos = uint64_t(os.tellp());
+  os.write(zeros, align(pos) - pos);
+}
+
+} // end of namespace binary
+} // end of namespace phylogeny
@@ -0,0 +1,266 @@
+#ifndef KGD_APOGET_BINARY_FORMAT_H
+#define KGD_APOGET_BINARY_FORMAT_H
+
+/*!
+ * \file binaryformat.h
+ *
+ * Contains the definition of the compact binary layout for phylogenetic trees
+ *
+ * A file is made of the following sections (all offsets are absolute and
+ * 8-bytes aligned, all values are in the writer's native byte order):
+ *   - Header
+ *   - alive species identificators (uint32_t[Header::alive])
+ *   - children identificators (uint32_t[Header::children])
+ *   - contributors (ContributorRecord[Header::contributors])
+ *   - intra-enveloppe distances (DistanceRecord[Header::distances])
+ *   - representatives blobs (see below)
+ *   - species (NodeRecord[Header::nodes]) in pre-order
+ *   - species index (IndexRecord[Header::nodes]) sorted by identificator
+ *   - removed species identificators (uint32_t[Header::removed], deltas only)
+ *
+ * Each species' representatives are stored contiguously in the blobs section
+ * starting at NodeRecord::blobOffset (relative to the section) as
+ * [timestamp, genome size, genome bytes, user data size, user data bytes] with
+ * 32 bits timestamp and sizes. Genomes and user data are converted through
+ * binary::Serializer.
+ *
+ * The species index (footer) maps identificators to species records so that
+ * a single species (or lineage) can be located with a binary search and read
+ * without touching the rest of the file. The alive species section is also
+ * sorted and can be searched in the same way.
+ *
+ * Delta checkpoints (Header::flags & DELTA) use the same layout but only
+ * contain the species modified since the checkpoint taken at
+ * Header::baseStep (with all their fields, including their complete list of
+ * children) along with the identificators of the species removed since then.
+ * Species that stayed alive are not considered modified: their last
+ * appearance is Header::step, as implied by the (complete) alive section.
+ * They can only be applied on top of that checkpoint (see
+ * PhylogeneticTree::applyDelta).
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "treetypes.h"
+
+namespace phylogeny {
+namespace binary {
+
+/// Current version of the layout. Must be incremented on any change
+static constexpr uint32_t VERSION = 3;
+
+/// Fixed-size file header
+struct Header {
+  char magic[4];         ///< Always 'APTB'
+  uint32_t version;      ///< Layout version
+  uint32_t endianness;   ///< Byte-order marker
+
+  uint32_t rsetSize;     ///< Enveloppe size the tree was built with
+  uint32_t step;         ///< Timestep at which the tree was saved
+  uint32_t stillborns;   ///< Number of stillborn species removed
+  uint32_t nextSID;      ///< Identificator for the next species
+
+  uint32_t nodes;        ///< Number of species
+  uint32_t alive;        ///< Number of alive species
+  uint32_t children;     ///< Number of parent-child links
+  uint32_t contributors; ///< Number of contributors (all species)
+  uint32_t distances;    ///< Number of distances (all species)
+
+  uint64_t aliveOffset;        ///< Start of the alive species section
+  uint64_t childrenOffset;     ///< Start of the children section
+  uint64_t contributorsOffset; ///< Start of the contributors section
+  uint64_t distancesOffset;    ///< Start of the distances section
+  uint64_t blobsOffset;        ///< Start of the representatives section
+  uint64_t nodesOffset;        ///< Start of the species section
+  uint64_t indexOffset;        ///< Start of the species index section
+
+  uint32_t flags;     ///< Combination of HeaderFlags
+  uint32_t baseStep;  ///< Step of the checkpoint a delta applies to
+  uint32_t removed;   ///< Number of removed species (deltas only)
+  uint32_t reserved;  ///< Unused (alignment)
+  uint64_t removedOffset; ///< Start of the removed species section
+
+  /// \returns a header with valid identification fields
+  static Header make (void);
+
+  /// \returns whether the identification fields match the current layout
+  bool valid (void) const;
+
+  /// Throws an std::invalid_argument if this header cannot be read back
+  void validate (void) const;
+};
+
+/// Possible values for Header::flags
+enum HeaderFlags : uint32_t {
+  DELTA = 1  ///< Only contains changes relative to a previous checkpoint
+};
+
+/// Fixed-size species record
+struct NodeRecord {
+  uint32_t sid;     ///< Species identificator
+  uint32_t parent;  ///< Main contributor (SID::INVALID for the root)
+
+  uint32_t firstAppearance;   ///< \copydoc SpeciesData::firstAppearance
+  uint32_t lastAppearance;    ///< \copydoc SpeciesData::lastAppearance
+  uint32_t count;             ///< \copydoc SpeciesData::count
+  uint32_t currentlyAlive;    ///< \copydoc SpeciesData::currentlyAlive
+  uint32_t pendingCandidates; ///< \copydoc SpeciesData::pendingCandidates
+
+  uint32_t rsetSize;  ///< Number of representatives
+
+  uint32_t firstChild;       ///< Index of the first child in its section
+  uint32_t childrenCount;    ///< Number of children
+
+  uint32_t firstContributor;  ///< Index of the first contributor in its section
+  uint32_t contributorsCount; ///< Number of contributors
+
+  uint32_t firstDistance;   ///< Index of the first distance in its section
+  uint32_t distancesCount;  ///< Number of distances
+
+  uint64_t blobOffset;  ///< Start of the representatives (relative)
+};
+
+/// Fixed-size contributor record
+struct ContributorRecord {
+  uint32_t sid;       ///< \copydoc Contributor::speciesID
+  uint32_t count;     ///< \copydoc Contributor::count
+  uint32_t elligible; ///< \copydoc Contributor::elligible
+};
+
+/// Fixed-size species index entry
+struct IndexRecord {
+  uint32_t sid;   ///< Species identificator
+  uint32_t node;  ///< Index of the species record in its section
+};
+
+/// Fixed-size intra-enveloppe distance record
+struct DistanceRecord {
+  uint32_t i;   ///< Index of the first representative
+  uint32_t j;   ///< Index of the second representative
+  float d;      ///< Distance between them
+};
+
+static_assert(sizeof(Header) == 128, "Unexpected header padding");
+static_assert(sizeof(NodeRecord) == 64, "Unexpected node record padding");
+static_assert(sizeof(ContributorRecord) == 12,
+              "Unexpected contributor record padding");
+static_assert(sizeof(DistanceRecord) == 12,
+              "Unexpected distance record padding");
+static_assert(sizeof(IndexRecord) == 8, "Unexpected index record padding");
+
+/// \returns \p offset rounded up to the next multiple of 8
+inline uint64_t align (uint64_t offset) {
+  return (offset + 7) & ~uint64_t(7);
+}
+
+/// \returns whether the stream \p is starts with a binary tree header.
+/// The stream position is left unchanged
+bool isBinary (std::istream &is);
+
+/// Writes \p count raw values from \p data into \p os
+template <typename T>
+void write (std::ostream &os, const T *data, size_t count = 1) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Only trivially copyable types can be written raw");
+  os.write(reinterpret_cast<const char*>(data), count * sizeof(T));
+}
+
+/// Reads \p count raw values from \p is into \p data
+template <typename T>
+void read (std::istream &is, T *data, size_t count = 1) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Only trivially copyable types can be read raw");
+  is.read(reinterpret_cast<char*>(data), count * sizeof(T));
+  if (!is)
+    utils::doThrow<std::invalid_argument>("Unexpected end of binary tree");
+}
+
+/// Searches the section of \p count values sorted by \p key, starting at
+/// absolute position \p offset in \p is, for the one whose key is \p k.
+/// Only O(log count) values are read.
+/// \returns whether such a value exists (stored in \p found)
+template <typename T, typename F>
+bool find (std::istream &is, std::streampos offset, uint32_t count,
+           uint32_t k, F key, T &found) {
+  const auto at = [&is, offset, &found] (uint32_t i) {
+    is.seekg(offset + std::streamoff(i * sizeof(T)));
+    read(is, &found);
+  };
+
+  uint32_t lo = 0, hi = count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    at(mid);
+    if (key(found) < k)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  if (lo == count) return false;
+  at(lo);
+  return key(found) == k;
+}
+
+/// Pads \p os with zeros up to the next 8-bytes boundary
+void pad (std::ostream &os);
+
+/// Read-only stream buffer over a memory region (e.g. a section read at once
+/// and shared by several decoding threads, each with its own buffer)
+class MemoryBuf : public std::streambuf {
+public:
+  /// Creates a buffer reading the \p size bytes at \p data
+  MemoryBuf (const char *data, size_t size) {
+    char *p = const_cast<char*>(data);
+    setg(p, p, p + size);
+  }
+
+protected:
+  /// Moves the read position \p off bytes away from \p dir
+  pos_type seekoff (off_type off, std::ios_base::seekdir dir,
+                    std::ios_base::openmode which) override {
+    off_type base = 0;
+    if (dir == std::ios_base::cur)       base = gptr() - eback();
+    else if (dir == std::ios_base::end)  base = egptr() - eback();
+
+    off_type p = base + off;
+    if (!(which & std::ios_base::in) || p < 0 || p > egptr() - eback())
+      return pos_type(off_type(-1));
+    setg(eback(), eback() + p, egptr());
+    return pos_type(p);
+  }
+
+  /// Moves the read position to \p pos
+  pos_type seekpos (pos_type pos, std::ios_base::openmode which) override {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+  }
+};
+
+/// Converts values of type \p T to and from raw bytes.
+///
+/// Defaults to the CBOR encoding of the value's json representation, empty
+/// types producing no bytes at all. Specialize for a more compact (or faster)
+/// encoding of a given genome or user data type.
+template <typename T>
+struct Serializer {
+  /// Stores the byte representation of \p value into \p bytes
+  static void toBytes (const T &value, std::vector<uint8_t> &bytes) {
+    bytes.clear();
+    if constexpr (!std::is_empty<T>::value) bytes = json::to_cbor(json(value));
+  }
+
+  /// Rebuilds \p value from its byte representation \p bytes
+  static void fromBytes (const std::vector<uint8_t> &bytes, T &value) {
+    if constexpr (!std::is_empty<T>::value)
+      value = json::from_cbor(bytes).get<T>();
+  }
+};
+
+} // end of namespace binary
+} // end of namespace phylogeny
+
+#endif // KGD_APOGET_BINARY_FORMAT_H
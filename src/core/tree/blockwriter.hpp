@@ -0,0 +1,150 @@
+#ifndef KGD_APOGET_BLOCKWRITER_HPP
+#define KGD_APOGET_BLOCKWRITER_HPP
+
+/*!
+ * \file blockwriter.hpp
+ *
+ * Contains the definition of the double-buffered file writer shared by the
+ * append-only outputs (journal, metrics)
+ */
+
+#include <condition_variable>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "treetypes.h"
+
+namespace phylogeny {
+
+/// Buffered writer of blocks of \p T into a file.
+///
+/// Items are appended to an in-memory block which is written out once full
+/// (or on flush()), either synchronously or by a dedicated I/O thread while
+/// the next block fills up (double buffering).
+/// All functions are thread-safe.
+///
+/// \tparam T the type of the buffered items
+template <typename T>
+class BlockWriter {
+public:
+  /// Writes a block of items into the output file
+  using Sink = std::function<void (std::ostream&, const std::vector<T>&)>;
+
+  /// Creates (truncates) \p filename to write blocks of \p capacity items
+  /// through \p sink. If \p threaded, full blocks are written by a dedicated
+  /// thread.
+  /// Throws std::invalid_argument if the file cannot be opened
+  BlockWriter (const std::string &filename, Sink sink, size_t capacity,
+               bool threaded)
+    : _ofs(filename, std::ios::binary | std::ios::trunc),
+      _sink(std::move(sink)), _capacity(std::max<size_t>(1, capacity)),
+      _stop(false) {
+
+    if (!_ofs)
+      throw std::invalid_argument ("Unable to open '" + filename
+                                   + "' for writing");
+
+    _buffer.reserve(_capacity);
+    if (threaded) _thread = std::thread(&BlockWriter::ioLoop, this);
+  }
+
+  /// Flushes pending items and stops the I/O thread (if any)
+  ~BlockWriter (void) {
+    flush();
+    if (_thread.joinable()) {
+      {
+        std::unique_lock lock (_mutex);
+        _stop = true;
+      }
+      _cv.notify_all();
+      _thread.join();
+    }
+  }
+
+  /// Writers hold a file
+  BlockWriter (const BlockWriter&) = delete;
+
+  /// Writers hold a file
+  BlockWriter& operator= (const BlockWriter&) = delete;
+
+  /// \returns the output file, e.g. to write a header before any item is
+  /// appended
+  std::ostream& stream (void) {
+    return _ofs;
+  }
+
+  /// Calls \p f on the current block (as a single atomic operation) and writes
+  /// it out if it is then full
+  template <typename F>
+  void append (F &&f) {
+    std::unique_lock lock (_mutex);
+    f(_buffer);
+    if (_buffer.size() >= _capacity) writeBuffer(lock);
+  }
+
+  /// Writes all buffered items and waits for them to reach the file
+  void flush (void) {
+    std::unique_lock lock (_mutex);
+    writeBuffer(lock);
+    if (_thread.joinable())
+      _cv.wait(lock, [this] { return _pending.empty() && _writing.empty(); });
+    _ofs.flush();
+  }
+
+private:
+  std::ofstream _ofs;  ///< Output file
+  Sink _sink;          ///< Block serializer
+  size_t _capacity;    ///< Block size triggering a write
+
+  std::mutex _mutex;   ///< Protects the blocks
+  std::vector<T> _buffer;   ///< Items being appended
+  std::vector<T> _pending;  ///< Items waiting for the I/O thread
+  std::vector<T> _writing;  ///< Items being written by the I/O thread
+
+  std::thread _thread;  ///< I/O thread (if any)
+  std::condition_variable _cv;  ///< Signals changes in the blocks or _stop
+  bool _stop;  ///< Whether the I/O thread should terminate
+
+  /// Hands the buffer over to the I/O thread (or writes it directly)
+  void writeBuffer (std::unique_lock<std::mutex> &lock) {
+    if (_buffer.empty()) return;
+
+    if (_thread.joinable()) {
+      // Double buffering: wait for the previous block to be taken
+      _cv.wait(lock, [this] { return _pending.empty(); });
+      _pending.swap(_buffer);
+      _cv.notify_all();
+
+    } else
+      _sink(_ofs, _buffer);
+
+    _buffer.clear();
+  }
+
+  /// I/O thread main loop
+  void ioLoop (void) {
+    std::unique_lock lock (_mutex);
+    while (true) {
+      _cv.wait(lock, [this] { return _stop || !_pending.empty(); });
+      if (_pending.empty()) return;  // Stopping with nothing left to write
+
+      // Recycles the previous block's (reserved) storage
+      _writing.swap(_pending);
+      _cv.notify_all();
+
+      lock.unlock();
+      _sink(_ofs, _writing);
+      lock.lock();
+
+      _writing.clear();
+      _cv.notify_all();
+    }
+  }
+};
+
+} // end of namespace phylogeny
+
+#endif // KGD_APOGET_BLOCKWRITER_HPP
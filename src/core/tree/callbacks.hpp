@@ -7,19 +7,36 @@
  * Contains the definition for the callbacks sent by the phylogenic tree
  */
 
+#include <tuple>
+#include <utility>
+
 #include "treetypes.h"
 
 namespace phylogeny {
 
 /// Contains a set of functions called by the phylogenic tree when each of the
-/// corresponding events occur
+/// corresponding events occur.
+///
+/// This default version observes nothing: trees using it skip all
+/// notifications at compile time (see CallbacksEnabled). Specializations
+/// either implement these functions directly or derive from Observers to
+/// fan the events out to several observers.
 template <typename PT>
 struct Callbacks_t {
+  /// Nothing to notify
+  static constexpr bool ENABLED = false;
+
   /// \brief Called when the PTree has been stepped.
   ///
   /// Provides the current step and the set of still-alive species
   void onStepped (uint /*step*/, const LivingSet &/*living*/) {}
 
+  /// \brief Called when the PTree has been stepped, before onStepped.
+  ///
+  /// Provides the current step and only the species that appeared in or
+  /// disappeared from the set of still-alive species since the previous step
+  void onSteppedDelta (uint /*step*/, const LivingDelta &/*delta*/) {}
+
   /// \brief Called to notify of a newly created species.
   ///
   /// Provides the identificators of both parent (if any) and new species
@@ -44,6 +61,129 @@ struct Callbacks_t {
   void onMajorContributorChanged (SID /*sid*/, SID /*oldMC*/, SID /*newMC*/) {}
 };
 
+/// Whether callbacks of type \p C observe anything, i.e. unless they declare a
+/// false \c ENABLED constant
+template <typename C, typename = void>
+struct CallbacksEnabled : std::true_type {};
+
+/// Uses the \c ENABLED constant of \p C
+template <typename C>
+struct CallbacksEnabled<C, std::void_t<decltype(C::ENABLED)>>
+  : std::bool_constant<C::ENABLED> {};
+
+namespace _details {
+
+/// Holds an observer constructed in place from a tuple of arguments
+template <typename O>
+struct ObserverSlot {
+  O observer; ///< The observer
+
+  /// Default-constructs the observer
+  ObserverSlot (void) = default;
+
+  /// Constructs the observer from the forwarded \p args
+  template <typename... ARGS>
+  ObserverSlot (std::tuple<ARGS...> &&args)
+    : ObserverSlot(std::move(args), std::index_sequence_for<ARGS...>{}) {}
+
+private:
+  /// Unpacks \p args into the observer's constructor
+  template <typename... ARGS, size_t... I>
+  ObserverSlot (std::tuple<ARGS...> &&args, std::index_sequence<I...>)
+    : observer(std::get<I>(std::move(args))...) {}
+};
+
+} // end of namespace _details
+
+/// Compile-time list of observers, all receiving every event, in order.
+///
+/// Observers are stored by value and called directly so that the fan-out is
+/// fully inlined (no virtual call nor per-observer indirection). An empty list
+/// is disabled (see CallbacksEnabled). To use it, derive the tree's
+/// Callbacks_t from it, e.g.:
+/// \code
+/// template <>
+/// struct phylogeny::Callbacks_t<MyTree>
+///   : phylogeny::Observers<MetricsObserver<MyTree>, MyLogger> {
+///   using Observers::Observers;
+/// };
+///
+/// MyTree::Callbacks callbacks (std::piecewise_construct,
+///                              std::forward_as_tuple(tree, writer),
+///                              std::forward_as_tuple());
+/// tree.setCallbacks(&callbacks);
+/// \endcode
+///
+/// \tparam OBSERVERS types providing the Callbacks_t member functions
+template <typename... OBSERVERS>
+class Observers {
+public:
+  /// Whether there is anything to notify
+  static constexpr bool ENABLED = (sizeof...(OBSERVERS) > 0);
+
+  /// Default-constructs all observers
+  Observers (void) = default;
+
+  /// Constructs each observer from the corresponding tuple in \p args (see
+  /// std::forward_as_tuple)
+  template <typename... TUPLES>
+  Observers (std::piecewise_construct_t, TUPLES&&... args)
+    : _observers(std::forward<TUPLES>(args)...) {}
+
+  /// \returns the \p I-th observer
+  template <size_t I>
+  auto& get (void) {
+    return std::get<I>(_observers).observer;
+  }
+
+  /// \returns the observer of type \p O
+  template <typename O>
+  O& get (void) {
+    return std::get<_details::ObserverSlot<O>>(_observers).observer;
+  }
+
+  /// Applies \p f to all observers
+  template <typename F>
+  void forEach (F &&f) {
+    std::apply([&f] (auto&... slots) { (f(slots.observer), ...); },
+               _observers);
+  }
+
+  /// \copydoc Callbacks_t::onStepped
+  void onStepped (uint step, const LivingSet &living) {
+    forEach([&] (auto &o) { o.onStepped(step, living); });
+  }
+
+  /// \copydoc Callbacks_t::onSteppedDelta
+  void onSteppedDelta (uint step, const LivingDelta &delta) {
+    forEach([&] (auto &o) { o.onSteppedDelta(step, delta); });
+  }
+
+  /// \copydoc Callbacks_t::onNewSpecies
+  void onNewSpecies (SID pid, SID sid) {
+    forEach([&] (auto &o) { o.onNewSpecies(pid, sid); });
+  }
+
+  /// \copydoc Callbacks_t::onGenomeEntersEnveloppe
+  void onGenomeEntersEnveloppe (SID sid, GID gid) {
+    forEach([&] (auto &o) { o.onGenomeEntersEnveloppe(sid, gid); });
+  }
+
+  /// \copydoc Callbacks_t::onGenomeLeavesEnveloppe
+  void onGenomeLeavesEnveloppe (SID sid, GID gid) {
+    forEach([&] (auto &o) { o.onGenomeLeavesEnveloppe(sid, gid); });
+  }
+
+  /// \copydoc Callbacks_t::onMajorContributorChanged
+  void onMajorContributorChanged (SID sid, SID oldMC, SID newMC) {
+    forEach([&] (auto &o) { o.onMajorContributorChanged(sid, oldMC, newMC); });
+  }
+
+private:
+  /// The observers
+  std::tuple<_details::ObserverSlot<OBSERVERS>...> _observers;
+};
+
 } // end of namespace phylogeny
 
 #endif // KGD_CALLBACKS_HPP
@@ -0,0 +1,187 @@
+#include <zlib.h>
+
+#include "compression.h"
+#include "threadpool.h"
+
+namespace phylogeny {
+namespace compression {
+
+/// zlib window size selecting the gzip wrapper (15 bits window + 16)
+static constexpr int GZIP_WINDOW = 15 + 16;
+
+/// zlib window size auto-detecting gzip or zlib wrappers (15 bits + 32)
+static constexpr int AUTO_WINDOW = 15 + 32;
+
+/// Size of the input/output chunks when decompressing
+static constexpr size_t CHUNK = 1 << 18;
+
+bool compressed (const stdfs::path &path) {
+  return path.extension() == EXTENSION;
+}
+
+/// \returns \p data compressed as a complete gzip member
+static std::vector<char> compressBlock (std::vector<char> data, int level) {
+  z_stream zs {};
+  if (deflateInit2(&zs, level, Z_DEFLATED, GZIP_WINDOW, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK)
+    utils::doThrow<std::runtime_error>("Failed to initialize compression");
+
+  std::vector<char> out (deflateBound(&zs, data.size()));
+  zs.next_in = reinterpret_cast<Bytef*>(data.data());
+  zs.avail_in = data.size();
+  zs.next_out = reinterpret_cast<Bytef*>(out.data());
+  zs.avail_out = out.size();
+
+  int ret = deflate(&zs, Z_FINISH);
+  out.resize(zs.total_out);
+  deflateEnd(&zs);
+
+  if (ret != Z_STREAM_END)
+    utils::doThrow<std::runtime_error>("Failed to compress block: ", ret);
+  return out;
+}
+
+// =============================================================================
+// == Output
+
+OStreamBuf::OStreamBuf (const stdfs::path &filename, int level, uint threads,
+                        size_t blockSize)
+  : _ofs(filename, std::ios::binary), _level(level),
+    _threads(threads > 0 ? threads : ThreadPool::global().size()),
+    _empty(true) {
+
+  _block.resize(blockSize);
+  setp(_block.data(), _block.data() + _block.size());
+}
+
+OStreamBuf::~OStreamBuf (void) {
+  // Destructors must not throw: failures are only visible through good()
+  try {
+    sync();
+  } catch (...) {}
+}
+
+OStreamBuf::int_type OStreamBuf::overflow (int_type c) {
+  submit();
+  if (!traits_type::eq_int_type(c, traits_type::eof())) {
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+  }
+  return _ofs ? traits_type::not_eof(c) : traits_type::eof();
+}
+
+int OStreamBuf::sync (void) {
+  // An empty file still needs one (empty) member to be valid
+  if (pptr() > pbase() || _empty)  submit();
+  while (!_jobs.empty()) drainOne();
+  _ofs.flush();
+  return _ofs ? 0 : -1;
+}
+
+void OStreamBuf::submit (void) {
+  std::vector<char> data (pbase(), pptr());
+  int level = _level;
+  _jobs.push_back(ThreadPool::global().submit(
+    [data = std::move(data), level] () mutable {
+      return compressBlock(std::move(data), level);
+  }));
+  _empty = false;
+  setp(_block.data(), _block.data() + _block.size());
+
+  while (_jobs.size() > _threads) drainOne();
+}
+
+void OStreamBuf::drainOne (void) {
+  // Remove the job first so that a failure does not leave a consumed future
+  std::future<std::vector<char>> job = std::move(_jobs.front());
+  _jobs.pop_front();
+  std::vector<char> out = job.get();
+  _ofs.write(out.data(), out.size());
+}
+
+// =============================================================================
+// == Input
+
+/// \returns the zlib stream behind opaque pointer \p p
+static z_stream& zstream (void *p) {
+  return *static_cast<z_stream*>(p);
+}
+
+IStreamBuf::IStreamBuf (const stdfs::path &filename)
+  : _ifs(filename, std::ios::binary), _ok(bool(_ifs)),
+    _zs(new z_stream {}), _in(CHUNK), _out(CHUNK), _outStart(0),
+    _memberEnded(true) {
+
+  if (inflateInit2(&zstream(_zs), AUTO_WINDOW) != Z_OK)  _ok = false;
+  setg(_out.data(), _out.data(), _out.data());
+}
+
+IStreamBuf::~IStreamBuf (void) {
+  inflateEnd(&zstream(_zs));
+  delete &zstream(_zs);
+}
+
+bool IStreamBuf::refill (void) {
+  z_stream &zs = zstream(_zs);
+  _ifs.read(_in.data(), _in.size());
+  zs.next_in = reinterpret_cast<Bytef*>(_in.data());
+  zs.avail_in = _ifs.gcount();
+  return zs.avail_in > 0;
+}
+
+IStreamBuf::int_type IStreamBuf::underflow (void) {
+  if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+  if (!_ok) return traits_type::eof();
+
+  z_stream &zs = zstream(_zs);
+  _outStart += egptr() - eback();
+
+  zs.next_out = reinterpret_cast<Bytef*>(_out.data());
+  zs.avail_out = _out.size();
+  while (zs.avail_out == _out.size()) {
+    if (zs.avail_in == 0 && !refill()) {
+      if (_memberEnded) break;
+      _ok = false;
+      utils::doThrow<std::invalid_argument>("Truncated compressed stream");
+    }
+
+    _memberEnded = false;
+    int ret = inflate(&zs, Z_NO_FLUSH);
+    if (ret == Z_STREAM_END) {
+      _memberEnded = true;
+
+      // Concatenated members: keep going with the next one
+      if (zs.avail_in == 0 && !refill())  break;
+      inflateReset(&zs);
+
+    } else if (ret != Z_OK) {
+      _ok = false;
+      utils::doThrow<std::invalid_argument>(
+        "Corrupted compressed stream (zlib error ", ret, ")");
+    }
+  }
+
+  size_t n = _out.size() - zs.avail_out;
+  setg(_out.data(), _out.data(), _out.data() + n);
+  return n > 0 ? traits_type::to_int_type(*gptr()) : traits_type::eof();
+}
+
+IStreamBuf::pos_type IStreamBuf::seekoff (off_type off,
+                                          std::ios_base::seekdir dir,
+                                          std::ios_base::openmode which) {
+  if (dir == std::ios_base::cur)
+    return seekpos(_outStart + (gptr() - eback()) + off, which);
+  return pos_type(off_type(-1));
+}
+
+IStreamBuf::pos_type IStreamBuf::seekpos (pos_type pos,
+                                          std::ios_base::openmode which) {
+  off_type p = off_type(pos) - off_type(_outStart);
+  if (!(which & std::ios_base::in) || p < 0 || p > egptr() - eback())
+    return pos_type(off_type(-1));
+  setg(eback(), eback() + p, egptr());
+  return pos;
+}
+
+} // end of namespace compression
+} // end of namespace phylogeny
@@ -0,0 +1,153 @@
+#ifndef KGD_APOGET_COMPRESSION_H
+#define KGD_APOGET_COMPRESSION_H
+
+/*!
+ * \file compression.h
+ *
+ * Contains the definition of transparent (gzip) compression streams for saved
+ * trees
+ *
+ * Output is split in fixed-size blocks compressed in parallel, each one
+ * producing a complete gzip member. The resulting multi-member file is a
+ * regular gzip file (e.g. readable by zcat).
+ */
+
+#include <deque>
+#include <fstream>
+#include <future>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "treetypes.h"
+
+namespace phylogeny {
+namespace compression {
+
+/// Extension of compressed files
+static constexpr const char *EXTENSION = ".gz";
+
+/// \returns whether \p path designates a compressed file (see EXTENSION)
+bool compressed (const stdfs::path &path);
+
+/// Stream buffer compressing blocks of data in parallel into a file
+class OStreamBuf : public std::streambuf {
+public:
+  /// Default size of the uncompressed blocks
+  static constexpr size_t DEFAULT_BLOCK = 1 << 20;
+
+  /// Creates a buffer writing into \p filename. Keeps at most \p threads
+  /// compressions in flight (0 for the size of ThreadPool::global(), on which
+  /// they run)
+  OStreamBuf (const stdfs::path &filename, int level, uint threads,
+              size_t blockSize);
+
+  /// Compresses and writes remaining data (errors are silently dropped, call
+  /// std::ostream::flush() beforehand to detect them)
+  ~OStreamBuf (void);
+
+  /// \returns whether the underlying file is usable
+  bool good (void) const {
+    return bool(_ofs);
+  }
+
+protected:
+  int_type overflow (int_type c) override;  ///< Buffer is full
+  int sync (void) override;                 ///< Writes everything out
+
+private:
+  std::ofstream _ofs;  ///< Output file
+  int _level;          ///< zlib compression level
+  uint _threads;       ///< Maximal number of compressions in flight
+
+  std::vector<char> _block; ///< Uncompressed data being accumulated
+  bool _empty;  ///< Whether no block was written yet
+
+  /// Blocks being compressed (in output order)
+  std::deque<std::future<std::vector<char>>> _jobs;
+
+  /// Queues the current block for compression
+  void submit (void);
+
+  /// Writes the oldest compressed block
+  void drainOne (void);
+};
+
+/// Stream buffer decompressing a (possibly multi-member) gzip file
+class IStreamBuf : public std::streambuf {
+public:
+  /// Creates a buffer reading from \p filename
+  explicit IStreamBuf (const stdfs::path &filename);
+
+  /// Releases the inflater
+  ~IStreamBuf (void);
+
+  /// \returns whether the underlying file is usable
+  bool good (void) const {
+    return _ok;
+  }
+
+protected:
+  int_type underflow (void) override;  ///< Buffer is exhausted
+
+  /// Only reports the current position
+  pos_type seekoff (off_type off, std::ios_base::seekdir dir,
+                    std::ios_base::openmode which) override;
+
+  /// Only supports moving inside the current buffer (e.g. to peek at a
+  /// file's signature)
+  pos_type seekpos (pos_type pos, std::ios_base::openmode which) override;
+
+private:
+  std::ifstream _ifs;  ///< Input file
+  bool _ok;            ///< Whether the inflater is usable
+
+  void *_zs;  ///< zlib stream state (opaque here)
+  std::vector<char> _in;  ///< Compressed data
+  std::vector<char> _out; ///< Decompressed data
+  uint64_t _outStart;     ///< Decompressed offset of _out
+
+  /// Whether the last member read was complete (i.e. the input can end here)
+  bool _memberEnded;
+
+  /// Refills the input buffer. \returns false at the end of the file
+  bool refill (void);
+};
+
+/// Output stream compressing its contents into a file
+class OStream : public std::ostream {
+public:
+  /// Creates a stream writing into \p filename. The badbit is set if the file
+  /// cannot be opened.
+  /// \see OStreamBuf
+  explicit OStream (const stdfs::path &filename, int level = 6,
+                    uint threads = 0,
+                    size_t blockSize = OStreamBuf::DEFAULT_BLOCK)
+    : std::ostream(nullptr), _buf(filename, level, threads, blockSize) {
+    rdbuf(&_buf);
+    if (!_buf.good()) setstate(std::ios::badbit);
+  }
+
+private:
+  OStreamBuf _buf;  ///< Compressing buffer
+};
+
+/// Input stream decompressing the contents of a file
+class IStream : public std::istream {
+public:
+  /// Creates a stream reading from \p filename. The badbit is set if the file
+  /// cannot be opened
+  explicit IStream (const stdfs::path &filename)
+    : std::istream(nullptr), _buf(filename) {
+    rdbuf(&_buf);
+    if (!_buf.good()) setstate(std::ios::badbit);
+  }
+
+private:
+  IStreamBuf _buf;  ///< Decompressing buffer
+};
+
+} // end of namespace compression
+} // end of namespace phylogeny
+
+#endif // KGD_APOGET_COMPRESSION_H
@@ -0,0 +1,439 @@
+#ifndef KGD_CONCURRENT_PHYLOGENETIC_TREE_HPP
+#define KGD_CONCURRENT_PHYLOGENETIC_TREE_HPP
+
+#include <array>
+#include <thread>
+
+#include "phylogenetictree.hpp"
+
+/*!
+ * \file concurrenttree.hpp
+ *
+ * Contains the definition of a phylogenetic tree accepting insertions from
+ * multiple threads
+ */
+
+namespace phylogeny {
+
+/// Phylogenetic tree whose insertion API (addGenome, delGenome,
+/// (un)registerCandidate) can be called concurrently from multiple threads.
+///
+/// Locking scheme:
+///   - The hierarchy (nodes collection, parent/children links, contributors
+///     elligibilities) is protected by a tree-wide shared mutex. Scoring and
+///     insertion into an existing species only require shared ownership.
+///     Species creation and major contributor changes require exclusive
+///     ownership, in which case the sequential algorithm is used verbatim.
+///   - Species contents (rset, distances, data, contributions) are protected
+///     by per-species locks (striped over a fixed-size table). Scoring takes
+///     them in shared mode, enveloppe updates and contributions in exclusive
+///     mode. Each lock carries a version number, incremented on every
+///     enveloppe modification, so that a score computed under shared
+///     ownership can be validated (and recomputed if needed) before insertion.
+///
+/// step() and all non-insertion functions (copying, saving, viewing) stop the
+/// world and must not be called concurrently with themselves.
+///
+/// \attention Callbacks are invoked from the inserting thread and, thus,
+/// must be thread-safe
+template <typename GENOME, typename UDATA>
+class ConcurrentPhylogeneticTree : public PhylogeneticTree<GENOME, UDATA> {
+  /// Helper alias to the sequential tree
+  using Base = PhylogeneticTree<GENOME, UDATA>;
+
+public:
+  /// \copydoc PhylogeneticTree::Genome
+  using Genome = typename Base::Genome;
+
+  /// \copydoc PhylogeneticTree::Node
+  using Node = typename Base::Node;
+
+  /// \copydoc PhylogeneticTree::Node_ptr
+  using Node_ptr = typename Base::Node_ptr;
+
+  /// \copydoc PhylogeneticTree::DCCache
+  using DCCache = typename Base::DCCache;
+
+  /// \copydoc PhylogeneticTree::SpeciesContribution
+  using SpeciesContribution = typename Base::SpeciesContribution;
+
+  /// \copydoc PhylogeneticTree::InsertionResult
+  using InsertionResult = typename Base::InsertionResult;
+
+  /// \copydoc PhylogeneticTree::Stats
+  using Stats = typename Base::Stats;
+
+  /// Number of locks shared by the species
+  static constexpr uint SPECIES_LOCKS = 256;
+
+  /// Create an empty concurrent PTree
+  ConcurrentPhylogeneticTree (void) : Base() {
+    enableLocking();
+  }
+
+  /// Creates a concurrent PTree from the contents of \p that (sequential) one
+  explicit ConcurrentPhylogeneticTree (const Base &that) : Base(that) {
+    enableLocking();
+  }
+
+  /// Creates a copy of \p that concurrent PTree
+  ConcurrentPhylogeneticTree (const ConcurrentPhylogeneticTree &that)
+    : Base(that) {
+    enableLocking();
+  }
+
+  /// Assigns the contents of \p that PTree to this one
+  ConcurrentPhylogeneticTree& operator= (ConcurrentPhylogeneticTree that) {
+    swap(static_cast<Base&>(*this), static_cast<Base&>(that));
+    return *this;
+  }
+
+// =============================================================================
+// == Thread-safe API
+
+  /// Thread-safe version of PhylogeneticTree::addGenome
+  InsertionResult addGenome (const Genome &g) {
+    APT_TRACE_ARG("addGenome", g.genealogy().self.gid);
+    while (true) {
+      Node_ptr target = nullptr;
+      InsertionResult res {SID::INVALID, nullptr};
+      bool reparent = false;
+      {
+        auto lock = sharedStructureLock();
+        if (!this->_root) break;
+
+        Outcome o = tryAddGenome(g, target, res, reparent);
+        if (o == Outcome::RETRY)      continue;
+        if (o == Outcome::EXCLUSIVE)  break;
+      }
+
+      if (reparent) {
+        auto lock = exclusiveStructureLock();
+        this->updateContributions(target, {});
+      }
+      return res;
+    }
+
+    // Root creation or new species: stop the world and do it sequentially
+    auto lock = exclusiveStructureLock();
+    if (!this->_root)
+      return Base::addGenome(g);
+    else
+      return addGenomeExclusive(g);
+  }
+
+  /// Thread-safe version of PhylogeneticTree::delGenome
+  void delGenome (const Genome &g) {
+    auto lock = sharedStructureLock();
+    SID sid = g.genealogy().self.sid;
+    const Node_ptr &species = this->nodeAt(sid);
+
+    Stats stats;
+    {
+      std::unique_lock slock (speciesLock(sid).mutex);
+      SpeciesData &data = species->data;
+      data.lastAppearance = this->_step;
+      data.currentlyAlive--;
+      species->touch();
+    }
+    stats.deletions++;
+    mergeStats(stats);
+  }
+
+  /// Thread-safe version of PhylogeneticTree::registerCandidate
+  void registerCandidate (const Genealogy &g) {
+    auto lock = sharedStructureLock();
+    performCandidacyRegistration(g, +1);
+  }
+
+  /// Thread-safe version of PhylogeneticTree::unregisterCandidate
+  void unregisterCandidate (const Genealogy &g) {
+    auto lock = sharedStructureLock();
+    performCandidacyRegistration(g, -1);
+  }
+
+  /// Thread-safe version of PhylogeneticTree::getUserData
+  const UDATA* getUserData (const PID &pid) const {
+    auto lock = sharedStructureLock();
+    return Base::getUserData(pid);
+  }
+
+  /// Thread-safe version of PhylogeneticTree::getUserData
+  UDATA* getUserData (const PID &pid) {
+    auto lock = sharedStructureLock();
+    std::unique_lock slock (speciesLock(pid.sid).mutex);
+    return Base::getUserData(pid);
+  }
+
+  /// Stop-the-world version of PhylogeneticTree::step
+  template <typename IT, typename F>
+  void step (uint step, IT begin, IT end, F sidExtractor) {
+    auto lock = exclusiveStructureLock();
+    Base::step(step, begin, end, sidExtractor);
+  }
+
+  /// Stop-the-world version of PhylogeneticTree::saveToAsync. The world is
+  /// only stopped for the duration of the copy
+  std::shared_future<bool> saveToAsync (const stdfs::path &filename) {
+    auto lock = exclusiveStructureLock();
+    return Base::saveToAsync(filename);
+  }
+
+  /// Stop-the-world version of PhylogeneticTree::saveDeltaTo
+  bool saveDeltaTo (const stdfs::path &filename) {
+    auto lock = exclusiveStructureLock();
+    return Base::saveDeltaTo(filename);
+  }
+
+  /// Stop-the-world version of PhylogeneticTree::publishSnapshot
+  typename Base::Snapshot_ptr publishSnapshot (void) {
+    auto lock = exclusiveStructureLock();
+    return Base::publishSnapshot();
+  }
+
+private:
+// =============================================================================
+// == Locks management
+
+  /// Lock for a subset of the species, with associated modification counter
+  struct alignas(64) SpeciesLock {
+    std::shared_mutex mutex;  ///< Protects the species contents
+    uint64_t version = 0;     ///< Enveloppe modifications counter
+  };
+
+  /// Protects the hierarchy
+  mutable std::shared_mutex _structureMutex;
+
+  /// Number of threads waiting for exclusive ownership of #_structureMutex.
+  /// Prevents writer starvation on reader-biased implementations
+  mutable std::atomic<uint> _pendingExclusive {0};
+
+  /// Protects the stats
+  std::mutex _statsMutex;
+
+  /// Per-species locks (striped)
+  mutable std::array<SpeciesLock, SPECIES_LOCKS> _speciesLocks;
+
+  /// Enables the locks managed by the sequential tree
+  void enableLocking (void) {
+    this->_representativesMutex.setEnabled(true);
+  }
+
+  /// \returns the lock associated with species \p sid
+  SpeciesLock& speciesLock (SID sid) const {
+    return _speciesLocks[std::underlying_type<SID>::type(sid) % SPECIES_LOCKS];
+  }
+
+  /// \returns a shared lock on the hierarchy, waiting for pending exclusive
+  /// requests first
+  std::shared_lock<std::shared_mutex> sharedStructureLock (void) const {
+    while (_pendingExclusive.load(std::memory_order_acquire) > 0)
+      std::this_thread::yield();
+    return std::shared_lock<std::shared_mutex>(_structureMutex);
+  }
+
+  /// \returns an exclusive lock on the hierarchy
+  std::unique_lock<std::shared_mutex> exclusiveStructureLock (void) {
+    _pendingExclusive++;
+    std::unique_lock<std::shared_mutex> lock (_structureMutex);
+    _pendingExclusive--;
+    return lock;
+  }
+
+  /// Accumulates insertion-local stats into the tree-wide ones
+  void mergeStats (const Stats &stats) {
+    std::unique_lock lock (_statsMutex);
+    this->_stats += stats;
+  }
+
+// =============================================================================
+// == Insertion helpers
+
+  /// Possible outcomes of an optimistic insertion
+  enum class Outcome {
+    DONE,       ///< Genome inserted
+    RETRY,      ///< Target species changed too much. Start over
+    EXCLUSIVE   ///< Genome requires creating a species
+  };
+
+  /// Scores \p species under shared ownership and stores the version of the
+  /// enveloppe it was computed with in \p version
+  float score (const Genome &g, const Node_ptr &species, DCCache &dccache,
+               Stats &stats, uint64_t &version) const {
+    SpeciesLock &l = speciesLock(species->id());
+    std::shared_lock lock (l.mutex);
+    version = l.version;
+    return Base::speciesMatchingScore(g, species, dccache, stats);
+  }
+
+  /// Retrieves the parent species for \p g
+  void parentSpecies (const Genealogy &genealogy,
+                      Node_ptr &s0, Node_ptr &s1) {
+    SID mSID = genealogy.mother.sid, fSID = genealogy.father.sid;
+
+    s0 = nullptr, s1 = nullptr;
+    if (mSID == SID::INVALID && fSID == SID::INVALID)
+      s0 = this->_root;
+
+    else if (fSID == SID::INVALID || mSID == fSID)
+      s0 = this->nodeAt(mSID);
+
+    else {
+      s0 = this->nodeAt(mSID);
+      s1 = this->nodeAt(fSID);
+    }
+  }
+
+  /// Removes (now obsolete) candidacy from species \p s
+  void removeCandidacy (const Node_ptr &s) {
+    std::unique_lock lock (speciesLock(s->id()).mutex);
+    if (s->data.pendingCandidates > 0) {
+      s->data.pendingCandidates--;
+      s->touch();
+    }
+  }
+
+  /// Attempts inserting \p g under shared ownership of the hierarchy.
+  /// \p target and \p res are set on success and \p reparent signals whether
+  /// the major contributor of \p target needs updating.
+  Outcome tryAddGenome (const Genome &g, Node_ptr &target,
+                        InsertionResult &res, bool &reparent) {
+    const Genealogy &genealogy = g.genealogy();
+    SID sid0 = genealogy.mother.sid, sid1 = genealogy.father.sid;
+
+    Node_ptr s0, s1;
+    parentSpecies(genealogy, s0, s1);
+
+    Stats stats;
+
+    DCCache dccache, bestDCCache;
+    Node_ptr best = nullptr;
+    float bestScore = -std::numeric_limits<float>::max();
+    std::map<SID, uint64_t> versions;
+
+    std::vector<Node_ptr> species;
+    SpeciesContribution contrib;
+    std::map<SID, float> scores;
+
+    species.push_back(s0);
+    contrib.emplace_back(sid0, 1 + (sid0 == sid1));
+    if (s1) {
+      species.push_back(s1);
+      contrib.emplace_back(sid1, 1);
+    }
+
+    // Find best top-level species
+    for (const Node_ptr &s: species) {
+      APT_TIME_PHASE(stats, PARENT_SCORING);
+      float sscore = score(g, s, dccache, stats, versions[s->id()]);
+      if (bestScore < sscore) {
+        best = s;
+        bestScore = sscore;
+        bestDCCache = dccache;
+      }
+      scores[s->id()] = sscore;
+    }
+
+    std::sort(contrib.begin(), contrib.end(),
+              [&scores] (const Contribution &lhs, const Contribution &rhs) {
+                return scores.at(lhs.species) >= scores.at(rhs.species);
+    });
+
+    // Find best derived species
+    if (bestScore <= 0)
+      Base::findBestDerived(species, best, bestScore, bestDCCache, stats,
+                            [&] (const Node_ptr &s, DCCache &c) {
+        return score(g, s, c, stats, versions[s->id()]);
+      });
+
+    // Needs a new species
+    if (bestScore <= 0) {
+      mergeStats(stats);
+      return Outcome::EXCLUSIVE;
+    }
+
+    {
+      SpeciesLock &l = speciesLock(best->id());
+      std::unique_lock lock (l.mutex);
+
+      // Enveloppe changed since scoring. Recompute and check again
+      if (l.version != versions.at(best->id())) {
+        bestScore = Base::speciesMatchingScore(g, best, bestDCCache, stats);
+        if (bestScore <= 0) {
+          mergeStats(stats);
+          return Outcome::RETRY;
+        }
+      }
+
+      UDATA *udata = nullptr;
+      {
+        APT_TIME_PHASE(stats, INSERT_INTO);
+        udata = this->insertInto(this->_step, g, best, bestDCCache,
+                                 this->_callbacks);
+      }
+      l.version++;
+
+      if (!contrib.empty()) {
+        APT_TIME_PHASE(stats, CONTRIBUTORS);
+        Node *mc = best->parent();
+        SID newMC = best->contributors.update(
+                      contrib, Node::elligibilityTester(this->_nodes));
+        reparent = (newMC != (mc ? mc->id() : SID::INVALID));
+      }
+
+      target = best;
+      res = InsertionResult{best->id(), udata};
+    }
+
+    // Only remove candidacies once the genome is definitely inserted
+    removeCandidacy(s0);
+    if (s1) removeCandidacy(s1);
+
+    stats.insertions++;
+    mergeStats(stats);
+    return Outcome::DONE;
+  }
+
+  /// Sequential insertion of \p g while owning the hierarchy exclusively
+  InsertionResult addGenomeExclusive (const Genome &g) {
+    const Genealogy &genealogy = g.genealogy();
+    Node_ptr s0, s1;
+    parentSpecies(genealogy, s0, s1);
+
+    if (s0->data.pendingCandidates > 0) {
+      s0->data.pendingCandidates--;
+      s0->touch();
+    }
+    if (s1 && s1->data.pendingCandidates > 0) {
+      s1->data.pendingCandidates--;
+      s1->touch();
+    }
+
+    auto res = Base::addGenome(g, s0, s1,
+                               genealogy.mother.sid, genealogy.father.sid);
+    speciesLock(res.sid).version++;
+    this->_stats.insertions++;
+    return res;
+  }
+
+  /// Thread-safe candidacy (un)registration
+  void performCandidacyRegistration (const Genealogy &g, int dir) {
+    SID mSID = g.mother.sid, fSID = g.father.sid;
+    if (mSID != SID::INVALID) {
+      const Node_ptr &m = this->nodeAt(mSID);
+      std::unique_lock lock (speciesLock(mSID).mutex);
+      m->data.pendingCandidates += dir;
+      m->touch();
+    }
+    if (mSID != fSID && fSID != SID::INVALID) {
+      const Node_ptr &f = this->nodeAt(fSID);
+      std::unique_lock lock (speciesLock(fSID).mutex);
+      f->data.pendingCandidates += dir;
+      f->touch();
+    }
+  }
+};
+
+} // end of namespace phylogeny
+
+#endif // KGD_CONCURRENT_PHYLOGENETIC_TREE_HPP
@@ -0,0 +1,279 @@
+#include <cstring>
+
+#include "journal.h"
+
+namespace phylogeny {
+
+/// File signature
+static constexpr char MAGIC [4] = { 'A', 'P', 'T', 'J' };
+
+/// Current version of the layout. Must be incremented on any change
+static constexpr uint32_t VERSION = 1;
+
+/// Byte-order marker (as written on the writer's architecture)
+static constexpr uint32_t ENDIANNESS = 0x01020304;
+
+/// Helper alias to the underlying type of species identificators
+using SID_ut = std::underlying_type<SID>::type;
+
+/// Helper alias to the underlying type of genomic identificators
+using GID_ut = std::underlying_type<GID>::type;
+
+// =============================================================================
+// == Writer
+
+/// Appends the raw value \p v to \p buffer
+template <typename T>
+static void put (std::vector<char> &buffer, const T &v) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Only trivially copyable types can be journaled");
+  const char *p = reinterpret_cast<const char*>(&v);
+  buffer.insert(buffer.end(), p, p + sizeof(T));
+}
+
+/// Writes \p records as is
+static void writeRecords (std::ostream &os, const std::vector<char> &records) {
+  os.write(records.data(), records.size());
+}
+
+JournalWriter::JournalWriter (const std::string &filename, bool threaded,
+                              size_t bufferSize)
+  : _writer(filename, writeRecords, bufferSize, threaded) {
+
+  std::ostream &os = _writer.stream();
+  os.write(MAGIC, sizeof(MAGIC));
+  os.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+  os.write(reinterpret_cast<const char*>(&ENDIANNESS), sizeof(ENDIANNESS));
+}
+
+JournalWriter::~JournalWriter (void) = default;
+
+void JournalWriter::flush (void) {
+  _writer.flush();
+}
+
+void JournalWriter::stepSet (uint step) {
+  _writer.append([&] (std::vector<char> &b) {
+    put(b, uint8_t(JournalEvent::SET_STEP));
+    put(b, uint32_t(step));
+  });
+}
+
+void JournalWriter::stepped (uint step, const LivingDelta &delta) {
+  _writer.append([&] (std::vector<char> &b) {
+    put(b, uint8_t(JournalEvent::STEPPED));
+    put(b, uint32_t(step));
+    put(b, uint32_t(delta.appeared.size()));
+    put(b, uint32_t(delta.disappeared.size()));
+    for (SID sid: delta.appeared)     put(b, SID_ut(sid));
+    for (SID sid: delta.disappeared)  put(b, SID_ut(sid));
+  });
+}
+
+void JournalWriter::genomeAdded (SID sid, const std::vector<uint8_t> &bytes) {
+  _writer.append([&] (std::vector<char> &b) {
+    put(b, uint8_t(JournalEvent::GENOME_ADDED));
+    put(b, SID_ut(sid));
+    put(b, uint32_t(bytes.size()));
+    b.insert(b.end(), bytes.begin(), bytes.end());
+  });
+}
+
+void JournalWriter::genomeRemoved (SID sid) {
+  _writer.append([&] (std::vector<char> &b) {
+    put(b, uint8_t(JournalEvent::GENOME_REMOVED));
+    put(b, SID_ut(sid));
+  });
+}
+
+void JournalWriter::candidacy (SID mother, SID father, bool registered) {
+  _writer.append([&] (std::vector<char> &b) {
+    put(b, uint8_t(registered ? JournalEvent::CANDIDACY
+                              : JournalEvent::CANCELLED_CANDIDACY));
+    put(b, SID_ut(mother));
+    put(b, SID_ut(father));
+  });
+}
+
+void JournalWriter::newSpecies (SID pid, SID sid) {
+  _writer.append([&] (std::vector<char> &b) {
+    put(b, uint8_t(JournalEvent::NEW_SPECIES));
+    put(b, SID_ut(pid));
+    put(b, SID_ut(sid));
+  });
+}
+
+void JournalWriter::genomeEntersEnveloppe (SID sid, GID gid) {
+  _writer.append([&] (std::vector<char> &b) {
+    put(b, uint8_t(JournalEvent::ENTERS_ENVELOPPE));
+    put(b, SID_ut(sid));
+    put(b, GID_ut(gid));
+  });
+}
+
+void JournalWriter::genomeLeavesEnveloppe (SID sid, GID gid) {
+  _writer.append([&] (std::vector<char> &b) {
+    put(b, uint8_t(JournalEvent::LEAVES_ENVELOPPE));
+    put(b, SID_ut(sid));
+    put(b, GID_ut(gid));
+  });
+}
+
+void JournalWriter::majorContributorChanged (SID sid, SID oldMC, SID newMC) {
+  _writer.append([&] (std::vector<char> &b) {
+    put(b, uint8_t(JournalEvent::MAJOR_CONTRIBUTOR_CHANGED));
+    put(b, SID_ut(sid));
+    put(b, SID_ut(oldMC));
+    put(b, SID_ut(newMC));
+  });
+}
+
+// =============================================================================
+// == Reader
+
+JournalReader::JournalReader (const std::string &filename)
+  : _ifs(filename, std::ios::binary) {
+
+  if (!_ifs)
+    throw std::invalid_argument ("Unable to open '" + filename
+                                 + "' for reading");
+
+  char magic [sizeof(MAGIC)];
+  uint32_t version = 0, endianness = 0;
+  _ifs.read(magic, sizeof(magic));
+  _ifs.read(reinterpret_cast<char*>(&version), sizeof(version));
+  _ifs.read(reinterpret_cast<char*>(&endianness), sizeof(endianness));
+
+  if (!_ifs || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+    throw std::invalid_argument ("'" + filename + "' is not a journal");
+
+  if (endianness != ENDIANNESS)
+    utils::doThrow<std::invalid_argument>(
+      "Journal was written with a different byte order");
+
+  if (version != VERSION)
+    utils::doThrow<std::invalid_argument>(
+      "Journal has version ", version, " while only version ", VERSION,
+      " is supported");
+
+  _start = _ifs.tellg();
+}
+
+bool JournalReader::next (Record &r) {
+  const auto read = [this] (auto &v) {
+    _ifs.read(reinterpret_cast<char*>(&v), sizeof(v));
+    return bool(_ifs);
+  };
+  const auto readSID = [&read] (SID &sid) {
+    SID_ut v;
+    if (!read(v)) return false;
+    sid = SID(v);
+    return true;
+  };
+  const auto readGID = [&read] (GID &gid) {
+    GID_ut v;
+    if (!read(v)) return false;
+    gid = GID(v);
+    return true;
+  };
+  const auto readSIDs = [&readSID] (std::vector<SID> &v, uint32_t n) {
+    v.resize(n);
+    for (SID &sid: v) if (!readSID(sid)) return false;
+    return true;
+  };
+
+  auto start = _ifs.tellg();
+  uint8_t type;
+  if (!read(type)) return false;
+  r.type = JournalEvent(type);
+
+  bool ok = true;
+  switch (r.type) {
+  case JournalEvent::SET_STEP:
+    ok = read(r.step);
+    break;
+
+  case JournalEvent::STEPPED: {
+    uint32_t appeared, disappeared;
+    ok = read(r.step) && read(appeared) && read(disappeared)
+      && (uint64_t(appeared) + disappeared) * sizeof(SID_ut) <= remaining()
+      && readSIDs(r.delta.appeared, appeared)
+      && readSIDs(r.delta.disappeared, disappeared);
+    break;
+  }
+
+  case JournalEvent::GENOME_ADDED: {
+    uint32_t size;
+    ok = readSID(r.sid) && read(size) && size <= remaining();
+    if (ok) {
+      r.bytes.resize(size);
+      _ifs.read(reinterpret_cast<char*>(r.bytes.data()), size);
+      ok = bool(_ifs);
+    }
+    break;
+  }
+
+  case JournalEvent::GENOME_REMOVED:
+    ok = readSID(r.sid);
+    break;
+
+  case JournalEvent::CANDIDACY:
+  case JournalEvent::CANCELLED_CANDIDACY:
+    ok = readSID(r.first) && readSID(r.second);
+    break;
+
+  case JournalEvent::NEW_SPECIES:
+    ok = readSID(r.first) && readSID(r.sid);
+    break;
+
+  case JournalEvent::ENTERS_ENVELOPPE:
+  case JournalEvent::LEAVES_ENVELOPPE:
+    ok = readSID(r.sid) && readGID(r.gid);
+    break;
+
+  case JournalEvent::MAJOR_CONTRIBUTOR_CHANGED:
+    ok = readSID(r.sid) && readSID(r.first) && readSID(r.second);
+    break;
+
+  default:
+    utils::doThrow<std::invalid_argument>(
+      "Unknown journal record type ", uint(type), " at byte ", start);
+  }
+
+  if (!ok) {  // Truncated record: stay before it
+    _ifs.clear();
+    _ifs.seekg(start);
+    _ifs.setstate(std::ios::eofbit);
+  }
+  return ok;
+}
+
+void JournalReader::seek (uint step) {
+  rewind();
+
+  std::streampos resume = _start;
+  Record r;
+  while (next(r)) {
+    if (r.type != JournalEvent::STEPPED) continue;
+    if (r.step > step)  break;
+    resume = _ifs.tellg();
+  }
+
+  _ifs.clear();
+  _ifs.seekg(resume);
+}
+
+uint64_t JournalReader::remaining (void) {
+  auto pos = _ifs.tellg();
+  _ifs.seekg(0, std::ios::end);
+  auto end = _ifs.tellg();
+  _ifs.seekg(pos);
+  return end - pos;
+}
+
+void JournalReader::rewind (void) {
+  _ifs.clear();
+  _ifs.seekg(_start);
+}
+
+} // end of namespace phylogeny
@@ -0,0 +1,148 @@
+#ifndef KGD_APOGET_JOURNAL_H
+#define KGD_APOGET_JOURNAL_H
+
+/*!
+ * \file journal.h
+ *
+ * Contains the definition of the append-only binary event journal
+ *
+ * A journal starts with a 12 bytes header (magic 'APTJ', version, byte-order
+ * marker) followed by records made of a 1 byte type and a type-dependent
+ * payload of 32 bits values (all in the writer's native byte order):
+ *   - SET_STEP: step
+ *   - STEPPED: step, #appeared, #disappeared, appeared..., disappeared...
+ *   - GENOME_ADDED: resulting species, #bytes, genome bytes
+ *   - GENOME_REMOVED: species
+ *   - CANDIDACY / CANCELLED_CANDIDACY: mother's species, father's species
+ *   - NEW_SPECIES: parent, species
+ *   - ENTERS_ENVELOPPE / LEAVES_ENVELOPPE: species, genome
+ *   - MAJOR_CONTRIBUTOR_CHANGED: species, old contributor, new contributor
+ *
+ * The first five are the tree's inputs (and are sufficient to replay its
+ * evolution, see PhylogeneticTree::replay) while the others mirror the
+ * Callbacks_t events (e.g. for animating a run without any genome).
+ */
+
+#include <fstream>
+
+#include "blockwriter.hpp"
+
+namespace phylogeny {
+
+/// Type of a journal record
+enum class JournalEvent : uint8_t {
+  SET_STEP,                   ///< PhylogeneticTree::setStep
+  STEPPED,                    ///< PhylogeneticTree::step
+  GENOME_ADDED,               ///< PhylogeneticTree::addGenome
+  GENOME_REMOVED,             ///< PhylogeneticTree::delGenome
+  CANDIDACY,                  ///< PhylogeneticTree::registerCandidate
+  CANCELLED_CANDIDACY,        ///< PhylogeneticTree::unregisterCandidate
+  NEW_SPECIES,                ///< Callbacks_t::onNewSpecies
+  ENTERS_ENVELOPPE,           ///< Callbacks_t::onGenomeEntersEnveloppe
+  LEAVES_ENVELOPPE,           ///< Callbacks_t::onGenomeLeavesEnveloppe
+  MAJOR_CONTRIBUTOR_CHANGED   ///< Callbacks_t::onMajorContributorChanged
+};
+
+/// Buffered writer for the journal layout (see journal.h).
+///
+/// Records are appended to an in-memory buffer which is written out once full
+/// (or on flush()), either synchronously or by a dedicated I/O thread (see
+/// BlockWriter).
+/// All functions are thread-safe.
+class JournalWriter {
+public:
+  /// Default size of the in-memory buffer
+  static constexpr size_t DEFAULT_BUFFER = 1 << 20;
+
+  /// Creates (truncates) the journal at \p filename.
+  /// If \p threaded, full buffers are written by a dedicated thread.
+  /// Throws std::invalid_argument if the file cannot be opened
+  JournalWriter (const std::string &filename, bool threaded = false,
+                 size_t bufferSize = DEFAULT_BUFFER);
+
+  /// Flushes pending records and stops the I/O thread (if any)
+  ~JournalWriter (void);
+
+  /// Journals hold a file
+  JournalWriter (const JournalWriter&) = delete;
+
+  /// Journals hold a file
+  JournalWriter& operator= (const JournalWriter&) = delete;
+
+  /// Writes all buffered records and waits for them to reach the file
+  void flush (void);
+
+  /// \name Tree inputs
+  ///@{
+
+  void stepSet (uint step);  ///< \copydoc JournalEvent::SET_STEP
+  void stepped (uint step, const LivingDelta &delta); ///< \copydoc JournalEvent::STEPPED
+  void genomeAdded (SID sid, const std::vector<uint8_t> &bytes); ///< \copydoc JournalEvent::GENOME_ADDED
+  void genomeRemoved (SID sid); ///< \copydoc JournalEvent::GENOME_REMOVED
+  void candidacy (SID mother, SID father, bool registered); ///< \copydoc JournalEvent::CANDIDACY
+
+  ///@}
+
+  /// \name Callbacks events
+  ///@{
+
+  void newSpecies (SID pid, SID sid); ///< \copydoc JournalEvent::NEW_SPECIES
+  void genomeEntersEnveloppe (SID sid, GID gid); ///< \copydoc JournalEvent::ENTERS_ENVELOPPE
+  void genomeLeavesEnveloppe (SID sid, GID gid); ///< \copydoc JournalEvent::LEAVES_ENVELOPPE
+  void majorContributorChanged (SID sid, SID oldMC, SID newMC); ///< \copydoc JournalEvent::MAJOR_CONTRIBUTOR_CHANGED
+
+  ///@}
+
+private:
+  BlockWriter<char> _writer;  ///< Buffered output
+};
+
+/// Sequential reader for the journal layout (see journal.h)
+class JournalReader {
+public:
+  /// A decoded record. Fields are only meaningful for some types (see
+  /// journal.h)
+  struct Record {
+    JournalEvent type;  ///< Type of record
+
+    uint step = 0;              ///< Timestep (SET_STEP, STEPPED)
+    SID sid = SID::INVALID;     ///< Species concerned (all but steps)
+    SID first = SID::INVALID;   ///< Parent, old contributor or mother
+    SID second = SID::INVALID;  ///< New contributor or father
+    GID gid = GID::INVALID;     ///< Genome (ENTERS/LEAVES_ENVELOPPE)
+
+    LivingDelta delta;  ///< Changes in living species (STEPPED)
+    std::vector<uint8_t> bytes; ///< Serialized genome (GENOME_ADDED)
+  };
+
+  /// Opens the journal at \p filename.
+  /// Throws std::invalid_argument if the file cannot be opened or is not a
+  /// journal
+  explicit JournalReader (const std::string &filename);
+
+  /// Reads the next record into \p r
+  /// \returns false when the end of the journal is reached.
+  /// A truncated trailing record (e.g. interrupted run) is treated as the end,
+  /// as is a record whose announced size exceeds what remains of the file
+  bool next (Record &r);
+
+  /// Moves to the records following the last STEPPED record whose step is
+  /// lower than or equal to \p step (or to the start if there is none), i.e.
+  /// to where a tree saved at \p step should resume its replay
+  void seek (uint step);
+
+  /// Moves back to the first record
+  void rewind (void);
+
+private:
+  std::ifstream _ifs;  ///< Input file
+  std::streampos _start;  ///< Position of the first record
+
+  /// \returns the number of bytes between the current position and the end
+  /// of the file
+  uint64_t remaining (void);
+};
+
+} // end of namespace phylogeny
+
+#endif // KGD_APOGET_JOURNAL_H
@@ -0,0 +1,114 @@
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mappedtree.h"
+
+namespace phylogeny {
+
+MappedTree::MappedTree (const std::string &filename)
+  : _data(nullptr), _size(0) {
+
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::invalid_argument ("Unable to open '" + filename
+                                 + "' for reading");
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(binary::Header)) {
+    close(fd);
+    throw std::invalid_argument ("'" + filename + "' is not a binary tree");
+  }
+
+  _size = st.st_size;
+  _data = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (_data == MAP_FAILED) {
+    _data = nullptr;
+    throw std::invalid_argument ("Unable to map '" + filename + "'");
+  }
+
+  try {
+    _header = at<binary::Header>(0, 1);
+    _header->validate();
+    if (_header->flags & binary::DELTA)
+      utils::doThrow<std::invalid_argument>(
+        "'", filename, "' is a delta checkpoint and cannot be viewed on its"
+        " own");
+
+    _alive = at<uint32_t>(_header->aliveOffset, _header->alive);
+    _children = at<uint32_t>(_header->childrenOffset, _header->children);
+    _contributors = at<binary::ContributorRecord>(_header->contributorsOffset,
+                                                  _header->contributors);
+    _distances = at<binary::DistanceRecord>(_header->distancesOffset,
+                                            _header->distances);
+    _nodes = at<binary::NodeRecord>(_header->nodesOffset, _header->nodes);
+    _index = at<binary::IndexRecord>(_header->indexOffset, _header->nodes);
+
+  } catch (...) {
+    munmap(_data, _size);
+    throw;
+  }
+}
+
+MappedTree::~MappedTree (void) {
+  if (_data)  munmap(_data, _size);
+}
+
+MappedTree::Node MappedTree::nodeAt (SID sid) const {
+  auto s = std::underlying_type<SID>::type(sid);
+  const binary::IndexRecord *end = _index + _header->nodes;
+  const binary::IndexRecord *i =
+    std::lower_bound(_index, end, s,
+                     [] (const binary::IndexRecord &r, uint32_t s) {
+    return r.sid < s;
+  });
+  if (i == end || i->sid != s)
+    utils::doThrow<std::invalid_argument>("No node found for species ", sid);
+
+  const binary::NodeRecord *r = record(i->node);
+  if (r->sid != s)
+    utils::doThrow<std::invalid_argument>("Corrupted index for species ", sid);
+  return Node(this, r);
+}
+
+MappedTree::Node MappedTree::nodeAtIndex (uint i) const {
+  return Node(this, record(i));
+}
+
+const binary::NodeRecord* MappedTree::record (uint32_t i) const {
+  if (i >= _header->nodes)
+    utils::doThrow<std::invalid_argument>("No species record at index ", i);
+
+  // Records are checked lazily so that opening does not touch every page
+  const binary::NodeRecord &r = _nodes[i];
+  if (uint64_t(r.firstChild) + r.childrenCount > _header->children
+      || uint64_t(r.firstContributor) + r.contributorsCount
+          > _header->contributors
+      || uint64_t(r.firstDistance) + r.distancesCount > _header->distances)
+    utils::doThrow<std::invalid_argument>("Corrupted record for species ",
+                                          r.sid);
+  return &r;
+}
+
+std::vector<MappedTree::Node> MappedTree::lineage (SID sid) const {
+  std::vector<Node> nodes;
+  for (Node n = nodeAt(sid); n; n = n.parent()) {
+    if (nodes.size() >= _header->nodes)
+      utils::doThrow<std::invalid_argument>("Cycle in the lineage of ", sid);
+    nodes.push_back(n);
+  }
+  std::reverse(nodes.begin(), nodes.end());
+  return nodes;
+}
+
+template <typename T>
+const T* MappedTree::at (uint64_t offset, uint64_t count) const {
+  if (offset % alignof(T) != 0 || offset + count * sizeof(T) > _size)
+    utils::doThrow<std::invalid_argument>(
+      "Truncated or corrupted binary tree (section at ", offset, ")");
+  return reinterpret_cast<const T*>(static_cast<const char*>(_data) + offset);
+}
+
+} // end of namespace phylogeny
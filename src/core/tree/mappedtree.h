@@ -0,0 +1,225 @@
+#ifndef KGD_APOGET_MAPPED_TREE_H
+#define KGD_APOGET_MAPPED_TREE_H
+
+/*!
+ * \file mappedtree.h
+ *
+ * Contains the definition of a read-only phylogenetic tree view working
+ * directly on a memory-mapped binary tree file
+ */
+
+#include "binaryformat.h"
+#include "speciesdata.hpp"
+#include "speciescontributors.h"
+
+namespace phylogeny {
+
+/// Read-only view of a binary phylogenetic tree file (see binaryformat.h).
+///
+/// The file is memory-mapped (shared, read-only): opening it only costs the
+/// header validation, all accessors read directly from the mapped pages which
+/// are shared between processes viewing the same file. Species are located
+/// through the file's index so that only the pages actually used are loaded.
+///
+/// Exposes the hierarchy, species data, contributors and enveloppe sizes.
+/// Genomes and user data require a typed PhylogeneticTree (see
+/// PhylogeneticTree::readFrom)
+class MappedTree {
+public:
+  /// Zero-copy contiguous range of records
+  template <typename T>
+  struct Range {
+    const T *first;  ///< First element
+    const T *last;   ///< Past-the-end element
+
+    /// \returns the first element
+    const T* begin (void) const {  return first;  }
+
+    /// \returns the past-the-end element
+    const T* end (void) const {  return last;  }
+
+    /// \returns the number of elements
+    size_t size (void) const {  return last - first;  }
+
+    /// \returns whether the range is empty
+    bool empty (void) const {  return first == last;  }
+
+    /// \returns the \p i-th element
+    const T& operator[] (size_t i) const {  return first[i];  }
+  };
+
+  /// Light-weight handle to a species record
+  class Node {
+    const MappedTree *_tree;  ///< Owning view
+    const binary::NodeRecord *_record;  ///< Mapped record
+
+  public:
+    /// Creates a handle to \p record in \p tree
+    Node (const MappedTree *tree, const binary::NodeRecord *record)
+      : _tree(tree), _record(record) {}
+
+    /// \returns whether this handle refers to an actual species
+    explicit operator bool (void) const {
+      return _record != nullptr;
+    }
+
+    /// \returns the species identificator
+    SID id (void) const {
+      return SID(_record->sid);
+    }
+
+    /// \returns the main contributor of this species (can be invalid)
+    Node parent (void) const {
+      if (SID(_record->parent) == SID::INVALID) return Node(_tree, nullptr);
+      return _tree->nodeAt(SID(_record->parent));
+    }
+
+    /// \returns the species data
+    SpeciesData data (void) const {
+      return SpeciesData { _record->firstAppearance, _record->lastAppearance,
+                           _record->count, _record->currentlyAlive,
+                           _record->pendingCandidates };
+    }
+
+    /// \returns the number of representatives in the enveloppe
+    uint rsetSize (void) const {
+      return _record->rsetSize;
+    }
+
+    /// \returns whether this species still has some members in the simulation
+    bool extinct (void) const {
+      return _record->currentlyAlive == 0 && _record->pendingCandidates == 0;
+    }
+
+    /// \returns the identificators of the subspecies
+    Range<uint32_t> childrenIDs (void) const {
+      const uint32_t *c = _tree->_children + _record->firstChild;
+      return { c, c + _record->childrenCount };
+    }
+
+    /// \returns the number of subspecies
+    uint childrenCount (void) const {
+      return _record->childrenCount;
+    }
+
+    /// \returns the \p i-th subspecies
+    Node child (uint i) const {
+      return _tree->nodeAt(SID(childrenIDs()[i]));
+    }
+
+    /// \returns the raw contributors records
+    Range<binary::ContributorRecord> contributors (void) const {
+      const auto *c = _tree->_contributors + _record->firstContributor;
+      return { c, c + _record->contributorsCount };
+    }
+
+    /// \returns the \p i-th contributor
+    Contributor contributor (uint i) const {
+      const auto &c = contributors()[i];
+      return Contributor(SID(c.sid), c.count, c.elligible);
+    }
+
+    /// \returns the raw intra-enveloppe distances records
+    Range<binary::DistanceRecord> distances (void) const {
+      const auto *d = _tree->_distances + _record->firstDistance;
+      return { d, d + _record->distancesCount };
+    }
+
+    /// \returns the underlying record
+    const binary::NodeRecord& record (void) const {
+      return *_record;
+    }
+  };
+
+  /// Maps the binary tree file \p filename.
+  /// Throws std::invalid_argument if the file cannot be opened or is not a
+  /// valid binary tree
+  explicit MappedTree (const std::string &filename);
+
+  /// Unmaps the file
+  ~MappedTree (void);
+
+  /// Mapped memory cannot be shared
+  MappedTree (const MappedTree&) = delete;
+
+  /// Mapped memory cannot be shared
+  MappedTree& operator= (const MappedTree&) = delete;
+
+  /// \returns the file header
+  const binary::Header& header (void) const {
+    return *_header;
+  }
+
+  /// \returns the timestep at which the tree was saved
+  uint step (void) const {
+    return _header->step;
+  }
+
+  /// \returns the enveloppe size the tree was built with
+  uint rsetSize (void) const {
+    return _header->rsetSize;
+  }
+
+  /// \returns the number of stillborn species removed
+  uint stillborns (void) const {
+    return _header->stillborns;
+  }
+
+  /// \returns the identificator the next species would have had
+  SID nextNodeID (void) const {
+    return SID(_header->nextSID);
+  }
+
+  /// \returns the number of species
+  uint width (void) const {
+    return _header->nodes;
+  }
+
+  /// \returns the primordial species (invalid if the tree is empty)
+  Node root (void) const {
+    return _header->nodes > 0 ? nodeAtIndex(0) : Node(this, nullptr);
+  }
+
+  /// \returns the \p i-th species in pre-order.
+  /// Throws std::invalid_argument if the record is out of bounds or corrupted
+  Node nodeAtIndex (uint i) const;
+
+  /// \returns the species with identificator \p sid.
+  /// Throws std::invalid_argument if no such species exists
+  Node nodeAt (SID sid) const;
+
+  /// \returns the lineage of species \p sid, from the primordial species to
+  /// \p sid included.
+  /// Throws std::invalid_argument if no such species exists
+  std::vector<Node> lineage (SID sid) const;
+
+  /// \returns the identificators of the species alive at save time
+  Range<uint32_t> aliveSpecies (void) const {
+    return { _alive, _alive + _header->alive };
+  }
+
+private:
+  void *_data;  ///< Start of the mapped region
+  size_t _size; ///< Size of the mapped region
+
+  const binary::Header *_header;  ///< Mapped header
+  const uint32_t *_alive;  ///< Mapped alive species section
+  const uint32_t *_children; ///< Mapped children section
+  const binary::ContributorRecord *_contributors; ///< Mapped contributors
+  const binary::DistanceRecord *_distances; ///< Mapped distances
+  const binary::NodeRecord *_nodes; ///< Mapped species table
+  const binary::IndexRecord *_index; ///< Mapped species index
+
+  /// \returns a pointer to the \p i-th species record after checking that it
+  /// (and the ranges it refers to) are within bounds
+  const binary::NodeRecord* record (uint32_t i) const;
+
+  /// \returns a pointer to the object at \p offset after checking that
+  /// \p count of them fit in the mapped region
+  template <typename T>
+  const T* at (uint64_t offset, uint64_t count) const;
+};
+
+} // end of namespace phylogeny
+
+#endif // KGD_APOGET_MAPPED_TREE_H
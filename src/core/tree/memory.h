@@ -0,0 +1,88 @@
+#ifndef KGD_APOGET_MEMORY_H
+#define KGD_APOGET_MEMORY_H
+
+/*!
+ * \file memory.h
+ *
+ * Contains the definition of the memory footprint breakdown of a phylogenetic
+ * tree and of the trait used to account for the heap usage of genomes and user
+ * data
+ */
+
+#include <ostream>
+#include <type_traits>
+
+#include "treetypes.h"
+
+namespace phylogeny {
+
+/// Heap bytes owned by an instance of \p T beyond sizeof(T) (e.g. the contents
+/// of a std::vector member). Defaults to 0 unless \p T has a member function
+/// `size_t heapSize() const`. Specialize for types that cannot be modified.
+template <typename T, typename = void>
+struct HeapSize {
+  /// \returns 0
+  static size_t of (const T&) { return 0; }
+};
+
+/// Uses the heapSize() member function, if any
+template <typename T>
+struct HeapSize<T, std::void_t<decltype(std::declval<const T&>().heapSize())>> {
+  /// \returns t.heapSize()
+  static size_t of (const T &t) { return t.heapSize(); }
+};
+
+namespace _details {
+
+/// Bookkeeping bytes of a node-based ordered container element (color,
+/// parent, left and right pointers)
+static constexpr size_t ORDERED_NODE_OVERHEAD = 4 * sizeof(void*);
+
+/// Bookkeeping bytes of a node-based hashed container element (next pointer
+/// and cached hash)
+static constexpr size_t HASHED_NODE_OVERHEAD = sizeof(void*) + sizeof(size_t);
+
+/// Bookkeeping bytes of a std::make_shared control block
+static constexpr size_t SHARED_CONTROL_BLOCK = 2 * sizeof(void*);
+
+} // end of namespace _details
+
+/// Breakdown of the memory used by a phylogenetic tree, in bytes
+struct MemoryFootprint {
+  size_t nodes = 0;         ///< Species nodes (and their indexing)
+  size_t genomes = 0;       ///< Enveloppe points (genomes, see HeapSize)
+  size_t userData = 0;      ///< Enveloppe points user data (see HeapSize)
+  size_t distances = 0;     ///< Intra-enveloppe distance maps
+  size_t contributors = 0;  ///< Species contributors collections
+  size_t children = 0;      ///< Subspecies collections
+  size_t living = 0;        ///< Set of currently alive species
+  size_t index = 0;         ///< Enveloppe points lookup table
+
+  /// \returns the sum of all categories
+  size_t total (void) const {
+    return nodes + genomes + userData + distances + contributors + children
+         + living + index;
+  }
+
+  /// Ad-oc structure for printing the header matching operator<<
+  struct Header {
+    /// Prints the header
+    friend std::ostream& operator<< (std::ostream &os, const Header&) {
+      return os << " PTMemTotal PTMemNodes PTMemGenomes PTMemUserData"
+                   " PTMemDistances PTMemContributors PTMemChildren"
+                   " PTMemLiving PTMemIndex";
+    }
+  };
+
+  /// Prints the total and all categories (in bytes)
+  friend std::ostream& operator<< (std::ostream &os, const MemoryFootprint &m) {
+    return os << " " << m.total() << " " << m.nodes << " " << m.genomes
+              << " " << m.userData << " " << m.distances << " "
+              << m.contributors << " " << m.children << " " << m.living << " "
+              << m.index;
+  }
+};
+
+} // end of namespace phylogeny
+
+#endif // KGD_APOGET_MEMORY_H
@@ -0,0 +1,83 @@
+#include <cstring>
+
+#include "metrics.h"
+
+namespace phylogeny {
+
+/// File signature
+static constexpr char MAGIC [4] = { 'A', 'P', 'T', 'M' };
+
+/// Current version of the layout. Must be incremented on any change
+static constexpr uint32_t VERSION = 1;
+
+/// Byte-order marker (as written on the writer's architecture)
+static constexpr uint32_t ENDIANNESS = 0x01020304;
+
+const std::array<const char*, StepMetrics::COLUMNS> StepMetrics::names {
+  "step", "species", "alive", "newSpecies", "extinctions", "entries", "exits",
+  "fullness", "depth"
+};
+
+MetricsWriter::MetricsWriter (const std::string &filename, Format format,
+                              size_t blockSize)
+  : _writer(filename,
+            [format] (std::ostream &os, const std::vector<StepMetrics> &b) {
+              write(os, format, b);
+            }, blockSize, true) {
+
+  std::ostream &os = _writer.stream();
+  if (format == Format::CSV) {
+    for (uint i=0; i<StepMetrics::COLUMNS; i++)
+      os << (i > 0 ? "," : "") << StepMetrics::names[i];
+    os << "\n";
+
+  } else {
+    const uint32_t columns = StepMetrics::COLUMNS;
+    os.write(MAGIC, sizeof(MAGIC));
+    os.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+    os.write(reinterpret_cast<const char*>(&ENDIANNESS), sizeof(ENDIANNESS));
+    os.write(reinterpret_cast<const char*>(&columns), sizeof(columns));
+    for (const char *n: StepMetrics::names)
+      os.write(n, std::strlen(n) + 1);
+  }
+}
+
+MetricsWriter::~MetricsWriter (void) = default;
+
+void MetricsWriter::push (const StepMetrics &m) {
+  _writer.append([&m] (std::vector<StepMetrics> &b) { b.push_back(m); });
+}
+
+void MetricsWriter::flush (void) {
+  _writer.flush();
+}
+
+void MetricsWriter::write (std::ostream &os, Format format,
+                           const std::vector<StepMetrics> &block) {
+  if (format == Format::CSV) {
+    for (const StepMetrics &m: block)
+      os << m.step << "," << m.species << "," << m.alive << ","
+         << m.newSpecies << "," << m.extinctions << "," << m.entries << ","
+         << m.exits << "," << m.fullness << "," << m.depth << "\n";
+    return;
+  }
+
+  // Columnar: row count then each field for all rows
+  auto column = [&os, &block] (auto field) {
+    for (const StepMetrics &m: block)
+      os.write(reinterpret_cast<const char*>(&(m.*field)), 4);
+  };
+  const uint32_t rows = block.size();
+  os.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+  column(&StepMetrics::step);
+  column(&StepMetrics::species);
+  column(&StepMetrics::alive);
+  column(&StepMetrics::newSpecies);
+  column(&StepMetrics::extinctions);
+  column(&StepMetrics::entries);
+  column(&StepMetrics::exits);
+  column(&StepMetrics::fullness);
+  column(&StepMetrics::depth);
+}
+
+} // end of namespace phylogeny
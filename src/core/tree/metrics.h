@@ -0,0 +1,194 @@
+#ifndef KGD_APOGET_METRICS_H
+#define KGD_APOGET_METRICS_H
+
+/*!
+ * \file metrics.h
+ *
+ * Contains the definition of the headless per-step species metrics exporter.
+ *
+ * Samples are written either as csv (one row per sample) or in a columnar
+ * binary layout: a 16 bytes header (magic 'APTM', version, byte-order marker,
+ * number of columns), the null-terminated columns names and then blocks made
+ * of a row count followed by each column's values (all 32 bits, in the
+ * writer's native byte order).
+ */
+
+#include <array>
+#include <atomic>
+
+#include "blockwriter.hpp"
+
+namespace phylogeny {
+
+/// Species-level metrics of a single step
+struct StepMetrics {
+  uint32_t step;          ///< Timestep
+  uint32_t species;       ///< Number of species in the tree
+  uint32_t alive;         ///< Number of alive species
+  uint32_t newSpecies;    ///< Species created since the previous sample
+  uint32_t extinctions;   ///< Species that died out since the previous sample
+  uint32_t entries;       ///< Genomes added to an enveloppe since the previous
+                          ///  sample
+  uint32_t exits;         ///< Genomes removed from an enveloppe since the
+                          ///  previous sample
+  float fullness;         ///< Mean enveloppe fill ratio of the alive species
+  uint32_t depth;         ///< Maximal depth of the tree (root at 0)
+
+  /// Number of fields
+  static constexpr uint COLUMNS = 9;
+
+  /// Fields names (in declaration order)
+  static const std::array<const char*, COLUMNS> names;
+};
+
+/// Buffered writer of step metrics (see metrics.h for the layouts).
+///
+/// Samples are appended to an in-memory block which, once full (or on
+/// flush()), is handed over to a dedicated I/O thread (see BlockWriter).
+/// All functions are thread-safe.
+class MetricsWriter {
+public:
+  /// Output layouts
+  enum class Format {
+    CSV,      ///< Text, one row per sample
+    BINARY    ///< Columnar blocks (see metrics.h)
+  };
+
+  /// Default number of samples per block
+  static constexpr size_t DEFAULT_BLOCK = 1024;
+
+  /// Creates (truncates) \p filename to write samples in \p format, by blocks
+  /// of \p blockSize samples.
+  /// Throws std::invalid_argument if the file cannot be opened
+  MetricsWriter (const std::string &filename, Format format = Format::CSV,
+                 size_t blockSize = DEFAULT_BLOCK);
+
+  /// Flushes pending samples and stops the I/O thread
+  ~MetricsWriter (void);
+
+  /// Writers hold a file
+  MetricsWriter (const MetricsWriter&) = delete;
+
+  /// Writers hold a file
+  MetricsWriter& operator= (const MetricsWriter&) = delete;
+
+  /// Appends sample \p m
+  void push (const StepMetrics &m);
+
+  /// Writes all buffered samples and waits for them to reach the file
+  void flush (void);
+
+private:
+  BlockWriter<StepMetrics> _writer;  ///< Buffered output
+
+  /// Writes \p block into \p os in layout \p format
+  static void write (std::ostream &os, Format format,
+                     const std::vector<StepMetrics> &block);
+};
+
+/// Headless observer aggregating per-step species metrics into a
+/// MetricsWriter every \c period steps.
+///
+/// Implements the Callbacks_t interface: event handlers only increment
+/// (atomic) counters while sampling costs a walk through the alive species
+/// and the hierarchy once per period. To use it, either forward the tree's
+/// Callbacks_t to it or derive the specialization from it, e.g.:
+/// \code
+/// template <>
+/// struct phylogeny::Callbacks_t<MyTree> : phylogeny::MetricsObserver<MyTree> {
+///   using MetricsObserver::MetricsObserver;
+/// };
+/// \endcode
+///
+/// \tparam PT the observed tree type
+template <typename PT>
+class MetricsObserver {
+public:
+  /// Observes \p tree and writes a sample every \p period steps to \p writer
+  MetricsObserver (const PT &tree, MetricsWriter &writer, uint period = 1)
+    : _tree(tree), _writer(writer), _period(std::max(1u, period)) {}
+
+  /// Samples the metrics if \p step is a multiple of the period
+  /// \copydetails Callbacks_t::onStepped
+  void onStepped (uint step, const LivingSet &living) {
+    if (step % _period != 0)  return;
+
+    StepMetrics m;
+    m.step = step;
+    m.species = _tree.width();
+    m.alive = living.size();
+    m.newSpecies = _newSpecies.exchange(0, std::memory_order_relaxed);
+    m.extinctions = _extinctions.exchange(0, std::memory_order_relaxed);
+    m.entries = _entries.exchange(0, std::memory_order_relaxed);
+    m.exits = _exits.exchange(0, std::memory_order_relaxed);
+
+    double fullness = 0;
+    for (SID sid: living) fullness += _tree.nodeAt(sid)->rsetSize();
+    m.fullness = living.empty() ? 0
+               : fullness / (double(living.size()) * _tree.rsetSize());
+
+    m.depth = depth();
+    _writer.push(m);
+  }
+
+  /// Counts the extinctions
+  /// \copydetails Callbacks_t::onSteppedDelta
+  void onSteppedDelta (uint, const LivingDelta &delta) {
+    _extinctions.fetch_add(delta.disappeared.size(),
+                           std::memory_order_relaxed);
+  }
+
+  /// Counts the new species
+  /// \copydetails Callbacks_t::onNewSpecies
+  void onNewSpecies (SID, SID) {
+    _newSpecies.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /// Counts the enveloppe entries
+  /// \copydetails Callbacks_t::onGenomeEntersEnveloppe
+  void onGenomeEntersEnveloppe (SID, GID) {
+    _entries.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /// Counts the enveloppe exits
+  /// \copydetails Callbacks_t::onGenomeLeavesEnveloppe
+  void onGenomeLeavesEnveloppe (SID, GID) {
+    _exits.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /// Nothing to do (the depth is recomputed when sampling)
+  /// \copydetails Callbacks_t::onMajorContributorChanged
+  void onMajorContributorChanged (SID, SID, SID) {}
+
+private:
+  const PT &_tree;          ///< The observed tree
+  MetricsWriter &_writer;   ///< Where to write the samples
+  uint _period;             ///< Number of steps between two samples
+
+  std::atomic<uint32_t> _newSpecies {0};   ///< New species counter
+  std::atomic<uint32_t> _extinctions {0};  ///< Extinctions counter
+  std::atomic<uint32_t> _entries {0};      ///< Enveloppe entries counter
+  std::atomic<uint32_t> _exits {0};        ///< Enveloppe exits counter
+
+  /// \returns the maximal depth of the tree
+  uint depth (void) const {
+    using Node = typename PT::Node;
+    if (!_tree.root())  return 0;
+
+    uint max = 0;
+    std::vector<std::pair<const Node*, uint>> stack {
+      { _tree.root().get(), 0 }
+    };
+    while (!stack.empty()) {
+      auto [n, d] = stack.back();
+      stack.pop_back();
+      max = std::max(max, d);
+      for (const auto &c: n->children())  stack.emplace_back(c.get(), d+1);
+    }
+    return max;
+  }
+};
+
+} // end of namespace phylogeny
+
+#endif // KGD_APOGET_METRICS_H
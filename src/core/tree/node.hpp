@@ -21,45 +21,21 @@ struct Node {
   /// Helper alias to a collection of nodes
   using Collection = std::map<SID, Ptr>;
 
-  /// Stores the data relative to an enveloppe point
+  /// Stores the data relative to an enveloppe point. Its user data is kept
+  /// apart (see Node::userData)
   struct Representative {
     uint timestamp; ///< Insertion date
     GENOME genome;  ///< The genome for this representant
-    std::unique_ptr<UDATA> userData; ///< Associated user managed statistics
 
-    /// Default constructor
-    Representative (void) = default;
-
-    /// Copy constructs a representative. User data is deep copied.
-    Representative (const Representative &that)
-      : genome(that.genome),
-        userData(std::make_unique<UDATA>(*that.userData)) {}
-
-    /// Defaulted move constructor
-    Representative (Representative &&) = default;
-
-    /// Assign another representative to this
-    Representative& operator= (Representative that) {
-      swap(*this, that);
-      return *this;
-    }
-
-    /// Creates the enveloppe point for genome \p g and default-initialize
-    /// the associated user data
+    /// Creates the enveloppe point for genome \p g
     static Representative make (const GENOME &g) {
-      return Representative(g);
+      return Representative{0, g};
     }
 
-    /// Serialize enveloppe point \p p into a json
-    friend void to_json (json &j, const Representative &p) {
-      j = { p.genome, *p.userData };
-    }
-
-    /// Deserialize enveloppe point \p p from a json
+    /// Deserialize enveloppe point \p p from a json (see
+    /// PhylogeneticTree::toJsonFlat for the layout)
     friend void from_json (const json &j, Representative &p) {
       p.genome = j[0].get<GENOME>();
-      p.userData = std::make_unique<UDATA>(phylogeny::GID::INVALID);
-      *p.userData = j[1].get<UDATA>();
     }
 
     /// Asserts that two enveloppe points are equal
@@ -67,23 +43,12 @@ struct Node {
                              const Representative &rhs, bool deepcopy) {
       using utils::assertEqual;
       assertEqual(lhs.genome, rhs.genome, deepcopy);
-      assertEqual(lhs.userData, rhs.userData, deepcopy);
-    }
-
-  private:
-    /// Creates a representative of the provided genome
-    Representative (const GENOME &genome)
-      : genome(genome),
-        userData(std::make_unique<UDATA>(genome.genealogy().self.gid)) {}
-
-    /// Swaps contents of the two representatives
-    void swap (Representative &lhs, Representative &rhs) {
-      using std::swap;
-      swap(lhs.genome, rhs.genome);
-      swap(lhs.userData, rhs.userData);
     }
   };
 
+  /// Helper alias to the user data of a collection of enveloppe points
+  using UserDataSet = std::vector<std::unique_ptr<UDATA>>;
+
 private:
   /// Prevents constructor access from outside the class
   struct cookie {};
@@ -100,16 +65,36 @@ public:
   /// Collection of contributors the this species' gene pool
   Contributors contributors;
 
-  /// Collection of borderoids (in opposition to centroids)
-  std::vector<Representative> rset;
+  /// Helper alias to a collection of enveloppe points
+  using RSet = std::vector<Representative>;
+
+  /// Collection of borderoids (in opposition to centroids). Shared with the
+  /// copies of this node until either one is modified. Only decoded on first
+  /// access when lazily loaded (see LoadMode::LAZY)
+  _details::CopyOnWrite<RSet> rset;
 
-  /// Cache map for the intra-enveloppe distances
-  _details::DistanceMap distances;
+  /// Cache map for the intra-enveloppe distances. Copy-on-write as well
+  _details::CopyOnWrite<_details::DistanceMap> distances;
+
+  /// User managed statistics of the enveloppe points (in the same order as
+  /// rset). Never shared: copies of this node get their own so that the
+  /// pointers handed out by the tree stay valid, and keep designating this
+  /// node's data, when rset detaches from these copies
+  UserDataSet userData;
+
+  /// Whether this species was modified since the last checkpoint (see
+  /// PhylogeneticTree::saveDeltaTo)
+  bool dirty;
+
+  /// Modification stamp, renewed whenever this species changes (see touch()).
+  /// Unique across all nodes so that snapshots can tell unchanged species apart
+  uint64_t version;
 
   /// Creates a node from a contributors collection (hidden from user. use the
   /// make_shared version)
   explicit Node (Contributors &&contribs, const cookie&)
-    : _parent(nullptr), contributors(contribs) {}
+    : _parent(nullptr), contributors(contribs), dirty(false),
+      version(nextVersion()) {}
 
   /// \returns a pointer to a newly allocated node created from the provided
   /// arguments
@@ -143,9 +128,15 @@ public:
     return _children[i];
   }
 
+  /// \returns the number of representatives, without decoding a lazily loaded
+  /// enveloppe (see LoadMode::LAZY)
+  uint rsetSize (void) const {
+    return rset.size();
+  }
+
   /// \returns the genome of representative \p i
-  auto representativeGenome (uint i) const {
-    return rset[i].genome;
+  const auto& representativeGenome (uint i) const {
+    return (*rset)[i].genome;
   }
 
   /// \returns the genetic identificator for representative \p i
@@ -158,8 +149,9 @@ public:
     return data.currentlyAlive == 0 && data.pendingCandidates == 0;
   }
 
-  /// Adds subspecies \p child to this node
+  /// Adds subspecies \p child to this node (and sets its parent accordingly)
   void addChild (Ptr child) {
+    child->_parent = this;
     _children.push_back(child);
   }
 
@@ -169,12 +161,17 @@ public:
                     _children.end());
   }
 
+  /// Removes all subspecies from this node
+  void clearChildren (void) {
+    _children.clear();
+  }
+
   /// Helper function generating a lambda binded to the provided collection
   /// \p nodes
   static auto elligibilityTester (const Collection &nodes) {
     using namespace std::placeholders;
     return std::bind(&Contributors::elligibile<Collection>,
-                     _1, _2, nodes);
+                     _1, _2, std::cref(nodes));
   }
 
   /// Updates the species contributions manager and the species' main parent
@@ -189,7 +186,10 @@ public:
   ///
   /// \returns the current (possibly changed?) parent
   Node* updateElligibilities (const Collection &nodes) {
-    SID mainSID = contributors.updateElligibilities(elligibilityTester(nodes));
+    bool changed = false;
+    SID mainSID = contributors.updateElligibilities(elligibilityTester(nodes),
+                                                    &changed);
+    if (changed)  touch();
     return updateParent(mainSID, nodes);
   }
 
@@ -201,7 +201,7 @@ public:
     while ((p = p->_parent))  spacing += "  ";
 
     os << spacing << "[" << n.id << "] ( ";
-    for (const Representative &p: n.rset)    os << p.genome.id() << " ";
+    for (const Representative &p: *n.rset)    os << p.genome.id() << " ";
     os << ")\n";
 
     for (const Ptr &ss: n._children)  os << *ss.get();
@@ -229,12 +229,25 @@ public:
     assertEqual(lhs.data, rhs.data, deepcopy);
     assertEqual(lhs.contributors, rhs.contributors, deepcopy);
     assertEqual(lhs.rset, rhs.rset, deepcopy);
+    assertEqual(lhs.userData, rhs.userData, deepcopy);
     assertEqual(lhs.distances, rhs.distances, deepcopy);
 
     assertEqual(lhs._children, rhs._children, deepcopy);
   }
 
+  /// Flags this species as modified (since the last checkpoint and snapshot)
+  void touch (void) {
+    dirty = true;
+    version = nextVersion();
+  }
+
 private:
+  /// \returns a fresh modification stamp
+  static uint64_t nextVersion (void) {
+    static std::atomic<uint64_t> next {0};
+    return next.fetch_add(1, std::memory_order_relaxed) + 1;
+  }
+
   /// Updates the parent with the, possibily null, species identified by \p sid
   Node* updateParent(SID sid, const Collection &nodes) {
     return _parent = (sid == SID::INVALID) ? nullptr : nodes.at(sid).get();
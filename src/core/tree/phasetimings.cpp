@@ -0,0 +1,67 @@
+#include <iomanip>
+
+#include "phasetimings.h"
+
+namespace phylogeny {
+
+const char* name (Phase p) {
+  static constexpr std::array<const char*, PHASES> names {
+    "ParentScoring", "FindBestDerived", "InsertInto", "MakeNode",
+    "Contributors", "Elligibilities", "Trimming"
+  };
+  return names.at(uint(p));
+}
+
+uint64_t PhaseTiming::quantile (double q) const {
+  if (calls == 0) return 0;
+  uint64_t target = std::max<uint64_t>(1, q * calls), seen = 0;
+  for (uint b=0; b<BUCKETS; b++) {
+    seen += histogram[b];
+    if (seen >= target)
+      return std::min(max, b == 0 ? uint64_t(0) : (uint64_t(1) << b) - 1);
+  }
+  return max;
+}
+
+PhaseTiming& PhaseTiming::operator+= (const PhaseTiming &that) {
+  calls += that.calls;
+  nanoseconds += that.nanoseconds;
+  max = std::max(max, that.max);
+  for (uint b=0; b<BUCKETS; b++)  histogram[b] += that.histogram[b];
+  return *this;
+}
+
+void PhaseTimings::header (std::ostream &os) {
+  for (uint i=0; i<PHASES; i++) {
+    const char *n = name(Phase(i));
+    os << " PT" << n << "Calls PT" << n << "Ns";
+  }
+}
+
+std::ostream& operator<< (std::ostream &os, const PhaseTimings &t) {
+  for (const PhaseTiming &p: t.phases)
+    os << " " << p.calls << " " << p.nanoseconds;
+  return os;
+}
+
+void PhaseTimings::dump (std::ostream &os) const {
+  auto flags = os.flags();
+  os << std::setw(16) << std::left << "Phase" << std::right
+     << std::setw(12) << "Calls" << std::setw(16) << "Total(ms)"
+     << std::setw(12) << "Avg(ns)" << std::setw(12) << "p50(ns)"
+     << std::setw(12) << "p99(ns)" << std::setw(12) << "Max(ns)" << "\n";
+  for (uint i=0; i<PHASES; i++) {
+    const PhaseTiming &p = phases[i];
+    os << std::setw(16) << std::left << name(Phase(i)) << std::right
+       << std::setw(12) << p.calls
+       << std::setw(16) << std::fixed << std::setprecision(3)
+                        << p.nanoseconds * 1e-6
+       << std::setw(12) << (p.calls ? p.nanoseconds / p.calls : 0)
+       << std::setw(12) << p.quantile(.5)
+       << std::setw(12) << p.quantile(.99)
+       << std::setw(12) << p.max << "\n";
+  }
+  os.flags(flags);
+}
+
+} // end of namespace phylogeny
@@ -0,0 +1,131 @@
+#ifndef KGD_APOGET_PHASE_TIMINGS_H
+#define KGD_APOGET_PHASE_TIMINGS_H
+
+/*!
+ * \file phasetimings.h
+ *
+ * Contains the definition of the (optional) per-phase timing instrumentation
+ * of the phylogenetic tree.
+ *
+ * Timers are only compiled in when WITH_PHASE_TIMINGS is defined (see the
+ * cmake option of the same name). Otherwise APT_TIME_PHASE expands to nothing.
+ */
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#include "treetypes.h"
+
+namespace phylogeny {
+
+/// Instrumented phases of the tree dynamics. Phases are timed inclusively
+/// (e.g. ELLIGIBILITIES is also accounted for in an enclosing CONTRIBUTORS)
+enum class Phase {
+  PARENT_SCORING,     ///< Scoring of the parents' species
+  FIND_BEST_DERIVED,  ///< Search through the parents' subspecies
+  INSERT_INTO,        ///< Enveloppe update (including computeContribution)
+  MAKE_NODE,          ///< Species creation
+  CONTRIBUTORS,       ///< Contributors update (and potential re-parenting)
+  ELLIGIBILITIES,     ///< Tree-wide elligibilities refresh
+  TRIMMING,           ///< Stillborn trimming
+
+  SIZE_               ///< Number of instrumented phases
+};
+
+/// Number of instrumented phases
+static constexpr uint PHASES = uint(Phase::SIZE_);
+
+/// \returns the name of \p p
+const char* name (Phase p);
+
+/// Cumulative time and latency histogram of a single phase
+struct PhaseTiming {
+  /// Number of histogram buckets. Bucket i holds latencies in [2^(i-1), 2^i[
+  /// nanoseconds (bucket 0 holds null latencies)
+  static constexpr uint BUCKETS = 64;
+
+  uint64_t calls = 0;        ///< Number of timed executions
+  uint64_t nanoseconds = 0;  ///< Cumulated duration
+  uint64_t max = 0;          ///< Longest execution
+  std::array<uint64_t, BUCKETS> histogram {};  ///< Latencies distribution
+
+  /// Registers an execution lasting \p ns nanoseconds
+  void record (uint64_t ns) {
+    uint b = 0;
+    for (uint64_t v = ns; v > 0 && b+1 < BUCKETS; v >>= 1) b++;
+    calls++;
+    nanoseconds += ns;
+    max = std::max(max, ns);
+    histogram[b]++;
+  }
+
+  /// \returns an upper bound (in nanoseconds) of the \p q-th latency quantile
+  uint64_t quantile (double q) const;
+
+  /// Accumulates the values of \p that into this timing
+  PhaseTiming& operator+= (const PhaseTiming &that);
+};
+
+/// Timings of all instrumented phases
+struct PhaseTimings {
+  std::array<PhaseTiming, PHASES> phases; ///< Per-phase timings
+
+  /// \returns the timing of phase \p p
+  PhaseTiming& operator[] (Phase p) { return phases[uint(p)];  }
+
+  /// \returns the timing of phase \p p
+  const PhaseTiming& operator[] (Phase p) const { return phases[uint(p)];  }
+
+  /// Accumulates the values of \p that into these timings
+  PhaseTimings& operator+= (const PhaseTimings &that) {
+    for (uint i=0; i<PHASES; i++) phases[i] += that.phases[i];
+    return *this;
+  }
+
+  /// Prints the columns names matching operator<<
+  static void header (std::ostream &os);
+
+  /// Prints, for each phase, the number of calls and cumulated duration (ns)
+  friend std::ostream& operator<< (std::ostream &os, const PhaseTimings &t);
+
+  /// Prints a human-readable table with the calls, cumulated and average
+  /// durations, median, 99th percentile and maximal latencies of each phase
+  void dump (std::ostream &os) const;
+};
+
+/// Records the lifetime of an instance in a given phase
+class PhaseTimer {
+  /// Helper alias to the clock used for timing
+  using Clock = std::chrono::steady_clock;
+
+  PhaseTiming &_timing;  ///< Where to record
+  Clock::time_point _start; ///< When the phase started
+
+public:
+  /// Starts timing into \p timing
+  explicit PhaseTimer (PhaseTiming &timing)
+    : _timing(timing), _start(Clock::now()) {}
+
+  /// Records the elapsed time
+  ~PhaseTimer (void) {
+    _timing.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     Clock::now() - _start).count());
+  }
+};
+
+} // end of namespace phylogeny
+
+#ifdef WITH_PHASE_TIMINGS
+/// Times the rest of the enclosing scope as phase \p PHASE in \p STATS
+#define APT_TIME_PHASE(STATS, PHASE) \
+  phylogeny::PhaseTimer _aptPhaseTimer_##PHASE \
+    ((STATS).timings[phylogeny::Phase::PHASE])
+#else
+/// Times the rest of the enclosing scope as phase \p PHASE in \p STATS
+/// (disabled)
+#define APT_TIME_PHASE(STATS, PHASE)
+#endif
+
+#endif // KGD_APOGET_PHASE_TIMINGS_H
@@ -3,9 +3,16 @@
 
 #include <vector>
 #include <map>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
 #include <memory>
 #include <fstream>
+#include <sstream>
 #include <bitset>
+#include <atomic>
+#include <mutex>
+#include <future>
 
 #include <cassert>
 #include <iostream>
@@ -13,8 +20,17 @@
 #include "../ptreeconfig.h"
 
 #include "treetypes.h"
+#include "binaryformat.h"
+#include "compression.h"
+#include "treesaxparser.h"
 #include "node.hpp"
+#include "snapshot.hpp"
 #include "callbacks.hpp"
+#include "journal.h"
+#include "threadpool.h"
+#include "phasetimings.h"
+#include "tracing.h"
+#include "memory.h"
 
 /*!
  * \file phylogenetictree.hpp
@@ -69,6 +85,10 @@ public:
   /// Specialization used by this tree. Uses CRTP
   using Callbacks = Callbacks_t<PhylogeneticTree<Genome, UserData>>;
 
+  /// Whether #Callbacks observe anything. Notifications are compiled out
+  /// otherwise
+  static constexpr bool CALLBACKS = CallbacksEnabled<Callbacks>::value;
+
   /// Helper alias for the configuration data
   using Config = config::PTree;
 
@@ -81,32 +101,43 @@ public:
   /// \copydoc phylogeny::InsertionResult
   using InsertionResult = phylogeny::InsertionResult<UserData>;
 
+  /// Location of a representative in the tree
+  struct RepresentativeSlot {
+    SID sid;    ///< Species whose enveloppe contains the representative
+    uint slot;  ///< Index of the representative in the species' rset
+  };
+
+  /// Helper alias to the representatives lookup table
+  using RepresentativesIndex = std::unordered_map<GID, RepresentativeSlot>;
+
+  /// Helper alias to the immutable view type
+  using Snapshot = TreeSnapshot<Genome>;
+
+  /// \copydoc TreeSnapshot::Ptr
+  using Snapshot_ptr = typename Snapshot::Ptr;
+
 // =============================================================================
 // == Resource management (creation, destruction, copy)
 
   /// Create an empty PTree
   PhylogeneticTree(void) {
-    _nextNodeID = SID(0);
+    _nextNodeID = 0;
     _rsetSize = Config::rsetSize();
     _stillborns = 0;
     _step = 0;
     _root = nullptr;
     _callbacks = nullptr;
+    _journal = nullptr;
+    _autoSnapshots = false;
+    _checkpointStep = 0;
+    _indexPending = false;
   }
 
-  /// Constructs a deep copy of that PTree
-  PhylogeneticTree (const PhylogeneticTree &that) {
-    _nextNodeID = that._nextNodeID;
-
-    _root = deepcopy(that._root);
-    updateElligibilities();
-
-    _callbacks = nullptr;
-
-    _rsetSize = that._rsetSize;
-    _stillborns = that._stillborns;
-    _step = that._step;
-  }
+  /// Constructs a copy of that PTree. Enveloppes (genomes and distances) are
+  /// shared with \p that until either tree modifies them while user data is
+  /// duplicated: pointers obtained from \p that keep designating its own data
+  PhylogeneticTree (const PhylogeneticTree &that)
+    : PhylogeneticTree(that, true) {}
 
   /// Assigns that PTree to this one
   PhylogeneticTree& operator= (PhylogeneticTree that) {
@@ -118,13 +149,47 @@ public:
   ~PhylogeneticTree (void) {}
 
 private:
-  /// Performs a deepcopy of that_n node and all descendants into this PTree
+  /// Constructs a copy of that PTree. Unless \p index, the enveloppe points
+  /// lookup table is left to be rebuilt on first use (see indexPending)
+  PhylogeneticTree (const PhylogeneticTree &that, bool index) {
+    _nextNodeID = that._nextNodeID.load();
+
+    _indexPending = !index || that._indexPending.load();
+    if (!_indexPending) {
+      std::shared_lock lock (that._representativesMutex);
+      _representatives = that._representatives;
+    }
+    _root = deepcopy(that._root);
+
+    _aliveSpecies = that._aliveSpecies;
+
+    _callbacks = nullptr;
+    _journal = nullptr;
+
+    _snapshot = std::atomic_load(&that._snapshot);
+    _autoSnapshots = that._autoSnapshots;
+
+    _removedSpecies = that._removedSpecies;
+    _checkpointStep = that._checkpointStep;
+
+    _rsetSize = that._rsetSize;
+    _stillborns = that._stillborns;
+    _step = that._step;
+  }
+
+  /// Copies that_n node and all descendants into this PTree. Only the
+  /// hierarchy and user data are duplicated: enveloppes are copy-on-write
   Node_ptr deepcopy (const Node_ptr &that_n) {
     Node_ptr this_n = Node::make_shared(that_n->contributors);
 
     this_n->data = that_n->data;
     this_n->rset = that_n->rset;
     this_n->distances = that_n->distances;
+    this_n->userData.reserve(that_n->userData.size());
+    for (const auto &ud: that_n->userData)
+      this_n->userData.push_back(std::make_unique<UserData>(*ud));
+    this_n->dirty = that_n->dirty;
+    this_n->version = that_n->version;
 
     _nodes[this_n->id()] = this_n;
 
@@ -137,10 +202,19 @@ private:
   /// Swap contents of the provided phylogenetic trees
   friend void swap (PhylogeneticTree &lhs, PhylogeneticTree &rhs) {
     using std::swap;
-    swap(lhs._nextNodeID, rhs._nextNodeID);
+    lhs._nextNodeID = rhs._nextNodeID.exchange(lhs._nextNodeID);
     swap(lhs._root, rhs._root);
     swap(lhs._nodes, rhs._nodes);
+    swap(lhs._representatives, rhs._representatives);
+    lhs._indexPending = rhs._indexPending.exchange(lhs._indexPending);
+    swap(lhs._aliveSpecies, rhs._aliveSpecies);
     swap(lhs._callbacks, rhs._callbacks);
+    swap(lhs._journal, rhs._journal);
+    lhs._snapshot = std::atomic_exchange(&rhs._snapshot,
+                                         std::atomic_load(&lhs._snapshot));
+    swap(lhs._autoSnapshots, rhs._autoSnapshots);
+    swap(lhs._removedSpecies, rhs._removedSpecies);
+    swap(lhs._checkpointStep, rhs._checkpointStep);
     swap(lhs._rsetSize, rhs._rsetSize);
     swap(lhs._stillborns, rhs._stillborns);
     swap(lhs._step, rhs._step);
@@ -178,12 +252,42 @@ public:
 
   /// \return the user data for enveloppe point \p gid or nullptr if it is a
   /// regular individual
-  UserData* getUserData (const PID &pid) const {
-    const auto &species = nodeAt(pid.sid);
-    for (const auto &ep: species->rset)
-      if (ep.genome.genealogy().self.gid == pid.gid)
-        return ep.userData.get();
-    return nullptr;
+  const UserData* getUserData (const PID &pid) const {
+    RepresentativeSlot rs = representative(pid.gid);
+    if (rs.sid == SID::INVALID || rs.sid != pid.sid)  return nullptr;
+    return nodeAt(pid.sid)->userData[rs.slot].get();
+  }
+
+  /// \copydoc getUserData
+  /// Marks the species as modified (see saveDeltaTo). The returned pointer
+  /// remains valid (and designates this tree's data) across copies of this
+  /// tree, until the genome leaves the enveloppe
+  UserData* getUserData (const PID &pid) {
+    RepresentativeSlot rs = representative(pid.gid);
+    if (rs.sid == SID::INVALID || rs.sid != pid.sid)  return nullptr;
+    Node_ptr &n = nodeAt(pid.sid);
+    n->touch();
+    return n->userData[rs.slot].get();
+  }
+
+  /// \return whether genome \p gid is currently part of an enveloppe
+  bool isRepresentative (GID gid) const {
+    return representative(gid).sid != SID::INVALID;
+  }
+
+  /// \return the location of representative \p gid or an invalid slot
+  /// (SID::INVALID) if it is a regular individual
+  RepresentativeSlot representative (GID gid) const {
+    indexPending();
+    std::shared_lock lock (_representativesMutex);
+    auto it = _representatives.find(gid);
+    if (it == _representatives.end())  return {SID::INVALID, uint(-1)};
+    return it->second;
+  }
+
+  /// \return the maximal number of enveloppe points per species
+  uint rsetSize (void) const {
+    return _rsetSize;
   }
 
   /// \return the current timestep for this PTree
@@ -193,7 +297,7 @@ public:
 
   /// Access current value without modifying it
   SID nextNodeID (void) const {
-    return _nextNodeID;
+    return SID(_nextNodeID.load());
   }
 
   /// Access current set of alive species ids
@@ -201,6 +305,12 @@ public:
     return _aliveSpecies;
   }
 
+  /// \return the last published snapshot (can be null).
+  /// Safe to call from any thread, even while the tree is being modified
+  Snapshot_ptr snapshot (void) const {
+    return std::atomic_load(&_snapshot);
+  }
+
 protected:
   /// \copydoc nodeAt
   auto& nodeAt (SID i) {
@@ -215,18 +325,45 @@ public:
   /// Sets the callbacks used by this ptree
   void setCallbacks (Callbacks *c) const { _callbacks = c; }
 
+  /// Sets the journal recording this ptree's evolution (see replay()).
+  /// Null (the default) disables journaling.
+  /// Throws std::logic_error on a ConcurrentPhylogeneticTree: the order of
+  /// concurrent insertions cannot be reproduced by a sequential replay
+  void setJournal (JournalWriter *j) {
+    if (j && _representativesMutex.enabled())
+      utils::doThrow<std::logic_error>(
+        "Concurrent trees cannot be journaled: their insertions are not"
+        " replayable");
+    _journal = j;
+  }
+
   /// Sets the current timestep for this PTree
   void setStep (uint step) {
     _step = step;
+    if (_journal) _journal->stepSet(step);
+  }
+
+  /// Sets whether a snapshot is automatically published at every step
+  void setAutoSnapshots (bool a) {
+    _autoSnapshots = a;
+  }
+
+  /// Captures the current state of the tree and makes it available to readers
+  /// (see snapshot()). Parts unchanged since the previous snapshot are shared.
+  /// \warning Must not be called concurrently with modifications of the tree
+  Snapshot_ptr publishSnapshot (void) {
+    Snapshot_ptr s = Snapshot::capture(_step,
+                                       _root ? _root->id() : SID::INVALID,
+                                       _nodes, _aliveSpecies,
+                                       std::atomic_load(&_snapshot));
+    std::atomic_store(&_snapshot, s);
+    return s;
   }
 
 protected:
-  /// Wraps incrementation of the species identificator counter
+  /// Wraps (atomic) incrementation of the species identificator counter
   SID nextNodeID (void) {
-    using SID_t = std::underlying_type<SID>::type;
-    SID curr = _nextNodeID;
-    _nextNodeID = SID(SID_t(_nextNodeID)+1);
-    return curr;
+    return SID(_nextNodeID++);
   }
 
 public:
@@ -238,27 +375,46 @@ public:
   /// genomes [\p begin,\p end[ extracted through \p geneticID
   ///
   /// Callbacks:
+  ///   - Callbacks_t::onSteppedDelta
   ///   - Callbacks_t::onStepped
   ///
+  /// Publishes a new snapshot if so requested (see setAutoSnapshots)
+  ///
   /// \tparam IT Iterator to the begin/end of the population list
   /// \tparam F Functor for extracting the genome id from an iterator
   template <typename IT, typename F>
   void step (uint step, IT begin, IT end, F sidExtractor) {
     // Determine which species are still alive
-    _aliveSpecies.clear();
+    LivingSet previous;
+    previous.swap(_aliveSpecies);
     for (IT it = begin; it != end; ++it)
       _aliveSpecies.insert(sidExtractor(*it));
 
-    // Update internal data
-    for (SID sid: _aliveSpecies)
-      nodeAt(sid)->data.lastAppearance = step;
+    // Update internal data. Alive species are not touched: their last
+    // appearance is implied by the alive set and the current step (see
+    // applyDelta). Only those that just disappeared need to be saved again
+    for (SID sid: _aliveSpecies)  nodeAt(sid)->data.lastAppearance = step;
+    for (SID sid: previous)
+      if (!_aliveSpecies.count(sid) && _nodes.count(sid))
+        nodeAt(sid)->touch();
     _step = step;
 
     static const auto &T = Config::stillbornTrimmingPeriod();
     if ((T > 0) && (_step % T) == 0)  performStillbornTrimming();
 
+    _stats.memory = memoryEstimate();
+
+    if (_autoSnapshots) publishSnapshot();
+
     // Potentially notify outside world
-    if (_callbacks) _callbacks->onStepped(step, _aliveSpecies);
+    if ((CALLBACKS && _callbacks) || _journal) {
+      LivingDelta delta = LivingDelta::between(previous, _aliveSpecies);
+      if (_journal) _journal->stepped(step, delta);
+      if (CALLBACKS && _callbacks) {
+        _callbacks->onSteppedDelta(step, delta);
+        _callbacks->onStepped(step, _aliveSpecies);
+      }
+    }
   }
 
   /// Insert \p g into this PTree
@@ -266,10 +422,15 @@ public:
   /// enveloppe, a pointer to the associated user data structure
   /// (nullptr otherwise).
   InsertionResult addGenome (const Genome &g) {
+    APT_TRACE_ARG("addGenome", g.genealogy().self.gid);
+
     // Ensure that the root exists
     if (!_root) {
       _root = makeNode(SpeciesContribution{});
-      return updateSpeciesContents(g, _root, DCCache{}, SpeciesContribution{});
+      auto ret = updateSpeciesContents(g, _root, DCCache{},
+                                       SpeciesContribution{});
+      journalAddition(g, ret);
+      return ret;
     }
 
     // Retrieve parent's species
@@ -290,10 +451,17 @@ public:
     }
 
     // Remove (now obsolete) candidacies
-    if (s0->data.pendingCandidates > 0)  s0->data.pendingCandidates--;
-    if (s1 && s1->data.pendingCandidates > 0)  s1->data.pendingCandidates--;
+    if (s0->data.pendingCandidates > 0) {
+      s0->data.pendingCandidates--;
+      s0->touch();
+    }
+    if (s1 && s1->data.pendingCandidates > 0) {
+      s1->data.pendingCandidates--;
+      s1->touch();
+    }
 
     auto ret = addGenome(g, s0, s1, mSID, fSID);
+    journalAddition(g, ret);
 
     _stats.insertions++;
 
@@ -303,21 +471,12 @@ public:
 
   /// Remove \p g from this PTree (and update relevant internal data)
   void delGenome (const Genome &g) {
-    SID sid = g.genealogy().self.sid;
-
-    if (debug())
-      std::cerr << "New last appearance of species " << sid << " is " << _step
-                << std::endl;
-
-    SpeciesData &data = nodeAt(sid)->data;
-    data.lastAppearance = _step;
-    data.currentlyAlive--;
-
-    _stats.deletions++;
+    delGenome(g.genealogy().self.sid);
   }
 
   /// Register candidate for future insertion attempt in either (sub)species
   void registerCandidate (const Genealogy &g) {
+    if (_journal) _journal->candidacy(g.mother.sid, g.father.sid, true);
     performCandidacyRegistration(g, +1);
   }
 
@@ -325,36 +484,161 @@ public:
   /// (sub)species.
   /// \warning Implies a previous call to registerCandidate() with the same \p g
   void unregisterCandidate (const Genealogy &g) {
+    if (_journal) _journal->candidacy(g.mother.sid, g.father.sid, false);
     performCandidacyRegistration(g, -1);
   }
 
+  /// Applies the tree inputs recorded in \p journal (see setJournal()), from
+  /// its current position, until (and including) step \p until.
+  ///
+  /// Starting from an empty tree, or from one saved at step \c s with the
+  /// journal positioned through JournalReader::seek(s), this rebuilds the
+  /// exact state of the recorded tree at \p until. Callbacks are triggered as
+  /// during the original run, which can thus be animated by replaying it
+  /// step by step.
+  ///
+  /// Throws std::logic_error if the replay diverges from the recording (e.g.
+  /// different configuration or genome implementation)
+  ///
+  /// \returns whether \p until was reached before the end of the journal
+  bool replay (JournalReader &journal, uint until = uint(-1)) {
+    JournalReader::Record r;
+    while (journal.next(r)) {
+      switch (r.type) {
+      case JournalEvent::SET_STEP:
+        setStep(r.step);
+        break;
+
+      case JournalEvent::STEPPED: {
+        LivingSet living = _aliveSpecies;
+        for (SID sid: r.delta.disappeared)  living.erase(sid);
+        living.insert(r.delta.appeared.begin(), r.delta.appeared.end());
+        step(r.step, living.begin(), living.end(), [] (SID sid) {
+          return sid;
+        });
+        if (r.step >= until)  return true;
+        break;
+      }
+
+      case JournalEvent::GENOME_ADDED: {
+        Genome g;
+        binary::Serializer<Genome>::fromBytes(r.bytes, g);
+        SID sid = addGenome(g).sid;
+        if (sid != r.sid)
+          utils::doThrow<std::logic_error>(
+            "Journal replay diverged at step ", _step, ": genome ",
+            g.genealogy().self.gid, " was inserted in species ", sid,
+            " instead of ", r.sid);
+        break;
+      }
+
+      case JournalEvent::GENOME_REMOVED:
+        delGenome(r.sid);
+        break;
+
+      case JournalEvent::CANDIDACY:
+      case JournalEvent::CANCELLED_CANDIDACY: {
+        Genealogy g;
+        g.mother.sid = r.first;
+        g.father.sid = r.second;
+        if (r.type == JournalEvent::CANDIDACY)
+          registerCandidate(g);
+        else
+          unregisterCandidate(g);
+        break;
+      }
+
+      default:  // Callbacks events are regenerated by the replay itself
+        break;
+      }
+    }
+    return false;
+  }
+
+protected:
+  /// Remove a genome from species \p sid (and update relevant internal data)
+  void delGenome (SID sid) {
+    if (_journal) _journal->genomeRemoved(sid);
+
+    if (debug())
+      std::cerr << "New last appearance of species " << sid << " is " << _step
+                << std::endl;
+
+    Node_ptr &n = nodeAt(sid);
+    n->data.lastAppearance = _step;
+    n->data.currentlyAlive--;
+    n->touch();
+
+    _stats.deletions++;
+  }
+
+  /// Records the insertion of \p g (with outcome \p res), if journaling
+  void journalAddition (const Genome &g, const InsertionResult &res) {
+    if (!_journal)  return;
+    std::vector<uint8_t> bytes;
+    binary::Serializer<Genome>::toBytes(g, bytes);
+    _journal->genomeAdded(res.sid, bytes);
+  }
+
+public:
+
 // =============================================================================
 // == Stats management
 
   /// Ad-oc structure for printing the stats header
   struct StatsHeader {
-    /// Prints the stats header
+    /// Prints the stats header (followed by the phase timings columns when
+    /// compiled with WITH_PHASE_TIMINGS)
     friend std::ostream& operator<< (std::ostream &os, const StatsHeader&) {
-      return os << " PTInsertions PTDeletions PTComparisons PTBranching";
+      os << " PTInsertions PTDeletions PTComparisons PTBranching"
+         << MemoryFootprint::Header{};
+#ifdef WITH_PHASE_TIMINGS
+      PhaseTimings::header(os);
+#endif
+      return os;
     }
   };
 
   /// Structure for storing statistics about the phylogenetic dynamics
   struct Stats {
-    uint insertions = 0;  ///< Number of genomes inserted
-    uint deletions = 0;   ///< Number of genomes removed
-    uint comparisons = 0; ///< Number of representatives tested
-    uint branching = 0;   ///< Number of subspecies at root points
+    uint64_t insertions = 0;  ///< Number of genomes inserted
+    uint64_t deletions = 0;   ///< Number of genomes removed
+    uint64_t comparisons = 0; ///< Number of representatives tested
+    uint64_t branching = 0;   ///< Number of subspecies at root points
+
+    /// Estimated memory usage, refreshed at every step (see memoryEstimate).
+    /// Tree-wide: not accumulated by operator+=
+    MemoryFootprint memory;
+
+#ifdef WITH_PHASE_TIMINGS
+    PhaseTimings timings; ///< Time spent in each phase
+#endif
+
+    /// Accumulates the values of \p that into these stats
+    Stats& operator+= (const Stats &that) {
+      insertions += that.insertions;
+      deletions += that.deletions;
+      comparisons += that.comparisons;
+      branching += that.branching;
+#ifdef WITH_PHASE_TIMINGS
+      timings += that.timings;
+#endif
+      return *this;
+    }
 
     /// Inserts provided stats in a default fashion
     friend std::ostream& operator<< (std::ostream &os, const Stats &s) {
-      return os << " " << s.insertions << " " << s.deletions << " "
-                << s.comparisons << " " << s.branching;
+      os << " " << s.insertions << " " << s.deletions << " "
+         << s.comparisons << " " << s.branching << s.memory;
+#ifdef WITH_PHASE_TIMINGS
+      os << s.timings;
+#endif
+      return os;
     }
 
   } _stats; ///< Field storing the phylogenetic dynamics
 
-  /// Resets the statistics
+  /// Resets the statistics (including the phase timings)
   void resetStats (void) {
     _stats = Stats{};
   }
@@ -364,12 +648,142 @@ public:
     return _stats;
   }
 
+  /// Prints a detailed per-phase timing report (see PhaseTimings::dump)
+  void dumpTimings (std::ostream &os) const {
+#ifdef WITH_PHASE_TIMINGS
+    _stats.timings.dump(os);
+#else
+    os << "Phase timings disabled (compile with WITH_PHASE_TIMINGS)\n";
+#endif
+  }
+
+// =============================================================================
+// == Memory accounting
+
+  /// \returns an estimate of the memory used by this tree, in constant time.
+  ///
+  /// Assumes evenly-sized enveloppes, a single contributor per species and
+  /// genomes/user data as heavy as the first representative of the root (see
+  /// HeapSize). Shared (copy-on-write) enveloppes are counted as owned.
+  /// \see memoryFootprint for the exact value
+  MemoryFootprint memoryEstimate (void) const {
+    using namespace _details;
+    using Representative = typename Node::Representative;
+
+    MemoryFootprint m;
+    const size_t S = _nodes.size();
+    if (S == 0) return m;
+
+    size_t P = S * _rsetSize;
+    if (!_indexPending) {
+      std::shared_lock lock (_representativesMutex);
+      P = _representatives.size();
+      m.index = indexFootprint();
+    }
+    const double k = double(P) / S;
+
+    size_t genomeHeap = 0, udataHeap = 0;
+    const RSet *sample = _root ? _root->rset.peek() : nullptr;
+    if (sample && !sample->empty()) {
+      genomeHeap = HeapSize<Genome>::of(sample->front().genome);
+      udataHeap = HeapSize<UserData>::of(*_root->userData.front());
+    }
+
+    m.nodes = S * nodeFootprint();
+    m.genomes = S * SHARED_CONTROL_BLOCK
+              + P * (sizeof(Representative) + genomeHeap);
+    m.userData = P * (sizeof(std::unique_ptr<UserData>) + sizeof(UserData)
+                      + udataHeap);
+    m.distances = S * (SHARED_CONTROL_BLOCK
+                       + size_t(k * (k - 1) / 2) * distanceFootprint());
+    m.contributors = S * sizeof(Contributor);
+    m.children = (S - 1) * sizeof(Node_ptr);
+    m.living = _aliveSpecies.size() * (ORDERED_NODE_OVERHEAD + sizeof(SID));
+    return m;
+  }
+
+  /// \returns the memory used by this tree, computed by walking through all
+  /// species in linear time.
+  ///
+  /// Enveloppes and distance maps shared between species of this tree are
+  /// counted once, those shared with copies of this tree are counted as
+  /// owned. Enveloppes not yet decoded (see LoadMode::LAZY) are not decoded:
+  /// only their representatives are accounted for.
+  MemoryFootprint memoryFootprint (void) const {
+    using namespace _details;
+    using Representative = typename Node::Representative;
+
+    MemoryFootprint m;
+    std::unordered_set<const void*> seen;
+    for (const auto &p: _nodes) {
+      const Node &n = *p.second;
+      m.nodes += nodeFootprint();
+      m.contributors += n.contributors.data().capacity() * sizeof(Contributor);
+      m.children += n.children().capacity() * sizeof(Node_ptr);
+
+      if (const RSet *rset = n.rset.peek()) {
+        if (seen.insert(rset).second) {
+          m.genomes += SHARED_CONTROL_BLOCK
+                     + rset->capacity() * sizeof(Representative);
+          for (const Representative &r: *rset)
+            m.genomes += HeapSize<Genome>::of(r.genome);
+        }
+      } else
+        m.genomes += n.rset.size() * sizeof(Representative);
+
+      m.userData += n.userData.capacity() * sizeof(std::unique_ptr<UserData>);
+      for (const auto &ud: n.userData)
+        m.userData += sizeof(UserData) + HeapSize<UserData>::of(*ud);
+
+      const DistanceMap *distances = n.distances.peek();
+      if (!distances || seen.insert(distances).second)
+        m.distances += SHARED_CONTROL_BLOCK
+                     + n.distances.size() * distanceFootprint();
+    }
+
+    m.living = _aliveSpecies.size() * (ORDERED_NODE_OVERHEAD + sizeof(SID));
+    if (!_indexPending) {
+      std::shared_lock lock (_representativesMutex);
+      m.index = indexFootprint();
+    }
+    return m;
+  }
+
+private:
+  /// Helper alias to the intra-enveloppe distances container
+  using DistanceMap = _details::DistanceMap;
+
+  /// Helper alias to a collection of enveloppe points
+  using RSet = typename Node::RSet;
+
+  /// \returns the bytes used by a single species node (excluding its
+  /// collections)
+  static constexpr size_t nodeFootprint (void) {
+    return _details::ORDERED_NODE_OVERHEAD + sizeof(typename Nodes::value_type)
+         + _details::SHARED_CONTROL_BLOCK + sizeof(Node);
+  }
+
+  /// \returns the bytes used by a single intra-enveloppe distance
+  static constexpr size_t distanceFootprint (void) {
+    return _details::ORDERED_NODE_OVERHEAD
+         + sizeof(typename DistanceMap::value_type);
+  }
+
+  /// \returns the bytes used by the enveloppe points lookup table
+  /// \warning Requires (at least) shared ownership of _representativesMutex
+  size_t indexFootprint (void) const {
+    return _representatives.bucket_count() * sizeof(void*)
+         + _representatives.size()
+           * (_details::HASHED_NODE_OVERHEAD
+              + sizeof(typename RepresentativesIndex::value_type));
+  }
+
 // =============================================================================
 // == Member variables
 
 private:
   /// Identificator for the next species
-  SID _nextNodeID;
+  std::atomic<std::underlying_type<SID>::type> _nextNodeID;
 
 protected:
   /// The PTree root. Null until the first genome is inserted
@@ -378,6 +792,20 @@ protected:
   /// Nodes collection for logarithmic access
   Nodes _nodes;
 
+  /// Enveloppe points lookup table for constant time access. Built on first
+  /// use for lazily loaded trees (see indexPending)
+  mutable RepresentativesIndex _representatives;
+
+  /// Whether #_representatives is yet to be built (see LoadMode::LAZY)
+  mutable std::atomic<bool> _indexPending;
+
+  /// Serializes the deferred construction of #_representatives
+  mutable std::mutex _indexMutex;
+
+  /// Protects #_representatives when inserting concurrently. Disabled (no-op)
+  /// by default
+  mutable _details::OptionalMutex _representativesMutex;
+
   /// Set of currently alive species
   LivingSet _aliveSpecies;
 
@@ -388,6 +816,24 @@ protected:
   /// Pointer to the callbacks object. Null by default
   mutable Callbacks *_callbacks;
 
+  /// Pointer to the journal recording this tree. Null by default
+  JournalWriter *_journal;
+
+  /// Last published snapshot. Only accessed through std::atomic_* functions
+  Snapshot_ptr _snapshot;
+
+  /// Whether to publish a snapshot at every step
+  bool _autoSnapshots;
+
+  /// Completion state of the last background save (see saveToAsync)
+  mutable std::shared_future<bool> _pendingSave;
+
+  /// Species removed since the last checkpoint (see saveDeltaTo)
+  std::vector<SID> _removedSpecies;
+
+  /// Step at which the last checkpoint was taken (see markClean)
+  uint _checkpointStep;
+
 // =============================================================================
 // == Helper functions
 
@@ -396,6 +842,8 @@ protected:
   /// Callbacks:
   ///   - Callbacks_t::onNewSpecies
   Node_ptr makeNode (const SpeciesContribution &contrib) {
+    APT_TIME_PHASE(_stats, MAKE_NODE);
+    APT_TRACE("makeNode");
 
     SID id = nextNodeID();
     Contributors c (id);
@@ -409,8 +857,7 @@ protected:
     p->data.currentlyAlive = 0;
     p->data.pendingCandidates = 0;
 
-    assert(p->contributors.getNodeID()
-           == SID(std::underlying_type<SID>::type(_nextNodeID)-1));
+    assert(p->contributors.getNodeID() < nextNodeID());
 
     _nodes[p->id()] = p;
 
@@ -418,9 +865,14 @@ protected:
     p->update(contrib, _nodes);
 
     Node *parent = p->parent();
-    if (parent) parent->addChild(p);
-    if (_callbacks)
-      _callbacks->onNewSpecies(parent ? parent->id() : SID::INVALID, p->id());
+    if (parent) {
+      parent->addChild(p);
+      parent->touch();
+    }
+    p->touch();
+    SID pid = parent ? parent->id() : SID::INVALID;
+    if (_journal)   _journal->newSpecies(pid, p->id());
+    if (CALLBACKS && _callbacks) _callbacks->onNewSpecies(pid, p->id());
 
     return p;
   }
@@ -428,16 +880,16 @@ protected:
   /// \todo remove one
   /// \return Whether \p g is similar enough to \p species
   static float speciesMatchingScoreSimicontinuous (const Genome &g,
-                                                   Node_ptr species,
+                                                   const Node_ptr &species,
                                                    DCCache &dccache,
                                                    Stats &stats) {
-    uint k = species->rset.size();
+    uint k = species->rset->size();
 
     dccache.clear();
     dccache.reserve(k);
 
     uint matable = 0;
-    for (const auto &ep: species->rset) {
+    for (const auto &ep: *species->rset) {
       double d = distance(g, ep.genome);
       double c = std::min(g.compatibility(d), ep.genome.compatibility(d));
 
@@ -454,16 +906,16 @@ protected:
   /// \todo remove one
   /// \return Whether \p g is similar enough to \p species
   static float speciesMatchingScoreContinuous (const Genome &g,
-                                               Node_ptr species,
+                                               const Node_ptr &species,
                                                DCCache &dccache,
                                                Stats &stats) {
-    uint k = species->rset.size();
+    uint k = species->rset->size();
 
     dccache.clear();
     dccache.reserve(k);
 
     float avgCompat = 0;
-    for (const auto &ep: species->rset) {
+    for (const auto &ep: *species->rset) {
       double d = distance(g, ep.genome);
       double c = std::min(g.compatibility(d), ep.genome.compatibility(d));
 
@@ -480,8 +932,9 @@ protected:
   /// \todo remove
   /// Proxy for delegating score computation to the appropriate function
   /// \see Config::FULL_CONTINUOUS
-  static float speciesMatchingScore (const Genome &g, Node_ptr species,
+  static float speciesMatchingScore (const Genome &g, const Node_ptr &species,
                                      DCCache &dccache, Stats &stats) {
+    APT_TRACE_ARG("score", species->id());
     auto f =
       Config::DEBUG_FULL_CONTINUOUS() ?
           speciesMatchingScoreContinuous
@@ -493,6 +946,23 @@ protected:
   void findBestDerived (const Genome &g, const std::vector<Node_ptr> &species,
                         Node_ptr &bestSpecies, float &bestScore,
                         DCCache &bestSpeciesDCCache) {
+    findBestDerived(species, bestSpecies, bestScore, bestSpeciesDCCache,
+                    _stats, [&g, this] (const Node_ptr &s, DCCache &dccache) {
+      return speciesMatchingScore(g, s, dccache, _stats);
+    });
+  }
+
+  /// Finds the best derived species amongst the list of parents using
+  /// \p score to evaluate each candidate
+  ///
+  /// \tparam F functor of signature float(const Node_ptr&, DCCache&)
+  template <typename F>
+  static void findBestDerived (const std::vector<Node_ptr> &species,
+                               Node_ptr &bestSpecies, float &bestScore,
+                               DCCache &bestSpeciesDCCache, Stats &stats,
+                               F score) {
+    APT_TIME_PHASE(stats, FIND_BEST_DERIVED);
+    APT_TRACE("findBestDerived");
 
     DCCache dccache;
 
@@ -523,17 +993,17 @@ protected:
         done |= (1<<k);
 
       } else {
-        _stats.branching++;
+        stats.branching++;
 
         const Node_ptr &subspecies = *it;
-        float score = speciesMatchingScore(g, subspecies, dccache, _stats);
+        float s = score(subspecies, dccache);
 
         if (debug() >= 2)
-          std::cerr << "\t\t" << subspecies->id() << ": " << score << std::endl;
+          std::cerr << "\t\t" << subspecies->id() << ": " << s << std::endl;
 
-        if (bestScore < score) {
+        if (bestScore < s) {
           bestSpecies = subspecies;
-          bestScore = score;
+          bestScore = s;
           bestSpeciesDCCache = dccache;
         }
 
@@ -585,6 +1055,7 @@ protected:
 
     // Find best top-level species
     for (uint i=0; i<species.size(); i++) {
+      APT_TIME_PHASE(_stats, PARENT_SCORING);
       Node_ptr s = species[i];
       float score = speciesMatchingScore(g, s, dccache, _stats);
       if (bestScore < score) {
@@ -654,13 +1125,11 @@ protected:
   /// Callbacks:
   ///   - Callbacks_t::onGenomeEntersEnveloppe
   ///   - Callbacks_t::onGenomeLeavesEnveloppe
-  UserData* insertInto (uint step, const Genome &g, Node_ptr species,
+  UserData* insertInto (uint step, const Genome &g, const Node_ptr &species,
                      const DCCache &dccache, Callbacks *callbacks) {
 
     using op = _details::DistanceMap::key_type;
-    const uint k = species->rset.size();
-
-    auto &dist = species->distances;
+    const uint k = species->rset->size();
 
     UserData *userData = nullptr;
 
@@ -668,11 +1137,23 @@ protected:
     if (k < _rsetSize) {
       if (debug())  std::cerr << "\tAppend to the enveloppe" << std::endl;
 
-      species->rset.push_back(Node::Representative::make(g));
-      userData = species->rset.back().userData.get();
-      species->rset.back().timestamp = _step;
-      if (callbacks)  callbacks->onGenomeEntersEnveloppe(species->id(),
-                                                         g.genealogy().self.gid);
+      auto &rset = species->rset.mut();
+      auto &dist = species->distances.mut();
+
+      rset.push_back(Node::Representative::make(g));
+      rset.back().timestamp = _step;
+      species->userData.push_back(
+        std::make_unique<UserData>(g.genealogy().self.gid));
+      userData = species->userData.back().get();
+      {
+        std::unique_lock lock (_representativesMutex);
+        _representatives[g.genealogy().self.gid] = {species->id(), k};
+      }
+      if (_journal)
+        _journal->genomeEntersEnveloppe(species->id(), g.genealogy().self.gid);
+      if (CALLBACKS && callbacks)
+        callbacks->onGenomeEntersEnveloppe(species->id(),
+                                           g.genealogy().self.gid);
       for (uint i=0; i<k; i++)
         dist[{i, k}] = dccache.distances[i];
 
@@ -682,7 +1163,8 @@ protected:
       std::vector<GID> ids (k);
       for (uint i=0; i<k; i++)  ids[i] = species->representativeId(i);
       _details::EnveloppeContribution ec =
-          computeContribution(dist, dccache.distances, g.genealogy().self.gid, ids);
+          computeContribution(*species->distances, dccache.distances,
+                              g.genealogy().self.gid, ids);
 
       // Genome inside the enveloppe. Nothing to do
       if (!ec.better) {
@@ -692,7 +1174,8 @@ protected:
 
       // Replace closest enveloppe point with new one
       } else {
-        typename Node::Representative &ep = species->rset[ec.than];
+        auto &dist = species->distances.mut();
+        typename Node::Representative &ep = species->rset.mut()[ec.than];
         auto ep_id = ep.genome.genealogy().self.gid;
 
         if (debug())
@@ -700,16 +1183,26 @@ protected:
                     << "than enveloppe point " << ec.than << " (id: "
                     << ep_id << ", c = " << ec.value << ")" << std::endl;
 
-        if (callbacks) {
+        if (_journal) {
+          _journal->genomeLeavesEnveloppe(species->id(), ep_id);
+          _journal->genomeEntersEnveloppe(species->id(),
+                                          g.genealogy().self.gid);
+        }
+        if (CALLBACKS && callbacks) {
           callbacks->onGenomeLeavesEnveloppe(species->id(), ep_id);
           callbacks->onGenomeEntersEnveloppe(species->id(), g.genealogy().self.gid);
         }
 
-        ep.userData->removedFromEnveloppe();
-        userData = ep.userData.get();
-        *ep.userData = UserData(ep_id);
+        userData = species->userData[ec.than].get();
+        userData->removedFromEnveloppe();
+        *userData = UserData(ep_id);
 
         ep.genome = g;
+        {
+          std::unique_lock lock (_representativesMutex);
+          _representatives.erase(ep_id);
+          _representatives[g.genealogy().self.gid] = {species->id(), ec.than};
+        }
         for (uint i=0; i<k; i++)
           if (i != ec.than)
             dist[op{i,ec.than}] = dccache.distances[i];
@@ -721,10 +1214,45 @@ protected:
     species->data.count++;
     species->data.currentlyAlive++;
     species->data.lastAppearance = step;
+    species->touch();
 
     return userData;
   }
 
+  /// Registers all of \p n's enveloppe points in the lookup table
+  void indexRepresentatives (const Node &n) {
+    if (_indexPending)  return;
+    std::unique_lock lock (_representativesMutex);
+    for (uint i=0; i<n.rset->size(); i++)
+      _representatives[n.representativeId(i)] = {n.id(), i};
+  }
+
+  /// Builds the enveloppe points lookup table of a lazily loaded tree (see
+  /// LoadMode::LAZY), thereby decoding all enveloppes. No-op otherwise
+  void indexPending (void) const {
+    if (!_indexPending)  return;
+
+    std::unique_lock indexLock (_indexMutex);
+    if (!_indexPending)  return;
+
+    std::unique_lock lock (_representativesMutex);
+    _representatives.clear();
+    for (const auto &p: _nodes) {
+      const Node &n = *p.second;
+      for (uint i=0; i<n.rset->size(); i++)
+        _representatives[n.representativeId(i)] = {n.id(), i};
+    }
+    _indexPending = false;
+  }
+
+  /// Removes all of \p n's enveloppe points from the lookup table
+  void unindexRepresentatives (const Node &n) {
+    if (_indexPending)  return;
+    std::unique_lock lock (_representativesMutex);
+    for (uint i=0; i<n.rset->size(); i++)
+      _representatives.erase(n.representativeId(i));
+  }
+
   /// Update species \p s by inserting genome \p g, updating the contributions
   /// and registering the GID>SID association in the genome's dedicated field
   InsertionResult
@@ -732,7 +1260,11 @@ protected:
                         const DCCache &cache,
                         const SpeciesContribution &ctb) {
 
-    UserData *userData = insertInto(_step, g, s, cache, _callbacks);
+    UserData *userData = nullptr;
+    {
+      APT_TIME_PHASE(_stats, INSERT_INTO);
+      userData = insertInto(_step, g, s, cache, _callbacks);
+    }
     if (!ctb.empty()) updateContributions(s, ctb);
     return InsertionResult{s->id(), userData};
   }
@@ -740,8 +1272,10 @@ protected:
   /// Update species \p s contributions with the provided values
   void updateContributions (Node_ptr s, const SpeciesContribution &contrib,
                             bool fromFile = false) {
+    APT_TIME_PHASE(_stats, CONTRIBUTORS);
     Node *oldMC = s->parent(),
          *newMC = s->update(contrib, _nodes);
+    if (!contrib.empty()) s->touch();
 
     // No node (except the primordial species which cannot be re-assigned)
     // should be parentless. Except when creating a node
@@ -753,6 +1287,9 @@ protected:
       // Parent changed. Update and notify
       if (oldMC)  oldMC->delChild(s);
       newMC->addChild(s);
+      if (oldMC)  oldMC->touch();
+      newMC->touch();
+      s->touch();
 
       if (!fromFile) {
         updateElligibilities();
@@ -762,8 +1299,12 @@ protected:
         checkMC();
 #endif
 
-        _callbacks->onMajorContributorChanged(s->id(),
-                                              oldMC->id(), newMC->id());
+        // A freshly created node has no previous parent
+        SID oldSID = oldMC ? oldMC->id() : SID::INVALID;
+        if (_journal)
+          _journal->majorContributorChanged(s->id(), oldSID, newMC->id());
+        if (CALLBACKS && _callbacks)
+          _callbacks->onMajorContributorChanged(s->id(), oldSID, newMC->id());
       }
     }
   }
@@ -771,6 +1312,8 @@ protected:
   /// Triggers a tree-wide update of all contributors elligibility
   /// \todo remove test
   void updateElligibilities (void) {
+    APT_TIME_PHASE(_stats, ELLIGIBILITIES);
+    APT_TRACE("updateElligibilities");
     for (auto &p: _nodes) {
       Node_ptr &n = p.second;
       Node *oldMC = n->parent(),
@@ -785,10 +1328,16 @@ protected:
   /// Actually updates the candidacy values
   void performCandidacyRegistration (const Genealogy &g, int dir) {
     SID mSID = g.mother.sid, fSID = g.father.sid;
-    if (mSID != SID::INVALID)
-      nodeAt(mSID)->data.pendingCandidates += dir;
-    if (mSID != fSID && fSID != SID::INVALID)
-      nodeAt(fSID)->data.pendingCandidates += dir;
+    if (mSID != SID::INVALID) {
+      Node_ptr &m = nodeAt(mSID);
+      m->data.pendingCandidates += dir;
+      m->touch();
+    }
+    if (mSID != fSID && fSID != SID::INVALID) {
+      Node_ptr &f = nodeAt(fSID);
+      f->data.pendingCandidates += dir;
+      f->touch();
+    }
   }
 
 #ifndef NDEBUG
@@ -802,7 +1351,7 @@ protected:
         continue;
       }
 
-      auto pc = n->parent()->children();
+      const auto &pc = n->parent()->children();
       if (std::find(pc.begin(), pc.end(), n) == pc.end())
         throw std::logic_error("Node is not attached to the correct parent");
     }
@@ -818,6 +1367,9 @@ protected:
     static const auto &D = Config::stillbornTrimmingDelay();
     static const float MD = Config::stillbornTrimmingMinDelay();
 
+    APT_TIME_PHASE(_stats, TRIMMING);
+    APT_TRACE_ARG("stillbornTrimming", _step);
+
     if (Config::DEBUG_STILLBORNS())
       std::cerr << "Performing stillborn trimming for step "
                 << _step << std::endl;
@@ -837,14 +1389,14 @@ protected:
       // Only process dead species
       if (!s.extinct()) continue;
 
-      bool underfilled = (s.rset.size() < T * _rsetSize);
+      bool underfilled = (s.rset->size() < T * _rsetSize);
       uint liveTime = s.data.lastAppearance - s.data.firstAppearance;
       uint deadTime = _step - s.data.lastAppearance;
       if (underfilled && std::max(MD, liveTime * D) < deadTime) {
         if (Config::DEBUG_STILLBORNS()) {
           std::cerr << "Removing species " << s.id() << " with enveloppe size of "
-                    << s.rset.size() << " / " << _rsetSize << " ("
-                    << 100. * s.rset.size() / _rsetSize << "%) and "
+                    << s.rset->size() << " / " << _rsetSize << " ("
+                    << 100. * s.rset->size() / _rsetSize << "%) and "
                     << "survival time of " << " max(" << MD << ", " << D << " * ("
                     << s.data.lastAppearance << " - " << s.data.firstAppearance
                     << ")) = " << std::max(MD, D * liveTime) << " < " << deadTime
@@ -852,7 +1404,12 @@ protected:
                     << std::endl;
         }
 
-        if (s.parent()) s.parent()->delChild(it->second);  // Erase from parent
+        if (s.parent()) {  // Erase from parent
+          s.parent()->delChild(it->second);
+          s.parent()->touch();
+        }
+        unindexRepresentatives(s);
+        _removedSpecies.push_back(s.id());
         _stillborns++;
         remove = true;
       }
@@ -883,49 +1440,229 @@ protected:
 // == Json conversion
 
 private:
+  /// Number of species (de)serialized by a single task
+  static constexpr size_t SERIALIZATION_GRAIN = 256;
+
   /// Serialize Node \p n into a json
   static json toJson (const Node &n) {
-    json j, jd, jc;
-
-    for (const auto &d: n.distances)
-      jd.push_back({d.first.first, d.first.second, d.second});
-
+    json j = toJsonFlat(n), jc = json::array();
     for (const auto &c: n.children())
       jc.push_back(toJson(*c));
+    j["children"] = std::move(jc);
+    return j;
+  }
+
+  /// Serialize Node \p n into a json, without its children
+  static json toJsonFlat (const Node &n) {
+    json j, jd = json::array();
+
+    for (const auto &d: *n.distances)
+      jd.push_back({d.first.first, d.first.second, d.second});
 
     j["id"] = n.id();
     j["data"] = n.data;
-    j["envlp"] = n.rset;
+    json je = json::array();
+    for (uint i=0; i<n.rsetSize(); i++)
+      je.push_back({ (*n.rset)[i].genome, *n.userData[i] });
+    j["envlp"] = std::move(je);
     j["contribs"] = n.contributors.data();
-    j["dists"] = jd;
-    j["children"] = jc;
+    j["dists"] = std::move(jd);
 
     return j;
   }
 
+  /// Serialize the whole hierarchy into a json.
+  /// Species are serialized independently, in parallel (see ThreadPool), and
+  /// then stitched to their parents bottom-up
+  json hierarchyToJson (void) const {
+    if (!_root) return json();
+
+    std::vector<const Node*> nodes = preorder();
+    std::vector<json> jsons (nodes.size());
+    ThreadPool::global().parallelFor(nodes.size(), SERIALIZATION_GRAIN,
+                                     [&nodes, &jsons] (size_t b, size_t e) {
+      for (size_t i=b; i<e; i++)  jsons[i] = toJsonFlat(*nodes[i]);
+    });
+
+    std::unordered_map<const Node*, size_t> indices;
+    indices.reserve(nodes.size());
+    for (size_t i=0; i<nodes.size(); i++) indices[nodes[i]] = i;
+
+    // In reverse pre-order, children are complete before their parent
+    for (size_t i=nodes.size(); i>0; i--) {
+      json jc = json::array();
+      for (const auto &c: nodes[i-1]->children())
+        jc.push_back(std::move(jsons[indices.at(c.get())]));
+      jsons[i-1]["children"] = std::move(jc);
+    }
+
+    return std::move(jsons[0]);
+  }
+
   /// Rebuilds PTree hierarchy and internal structure based on the contents of
-  /// json \p j
-  Node_ptr rebuildHierarchy(const json &j) {
+  /// json \p j.
+  /// Species are decoded independently, in parallel (see ThreadPool), and
+  /// then registered and attached to their parent in pre-order
+  /// \returns the number of species read
+  size_t rebuildHierarchy(const json &j, LoadMode mode) {
+    static constexpr size_t NONE = -1;
+    std::vector<const json*> jsons;
+    std::vector<size_t> parents;
+    std::vector<std::pair<const json*, size_t>> stack { { &j, NONE } };
+    while (!stack.empty()) {
+      auto [jn, parent] = stack.back();
+      stack.pop_back();
+      const json &jc = (*jn)["children"];
+      for (auto it = jc.rbegin(); it != jc.rend(); ++it)
+        stack.emplace_back(&*it, jsons.size());
+      jsons.push_back(jn);
+      parents.push_back(parent);
+    }
+
+    std::vector<Node_ptr> nodes (jsons.size());
+    ThreadPool::global().parallelFor(jsons.size(), SERIALIZATION_GRAIN,
+                                     [&jsons, &nodes, mode] (size_t b,
+                                                             size_t e) {
+      for (size_t i=b; i<e; i++)  nodes[i] = decodeNode(*jsons[i], mode);
+    });
+
+    for (size_t i=0; i<nodes.size(); i++) {
+      registerNode(nodes[i]);
+      if (parents[i] != NONE) nodes[parents[i]]->addChild(nodes[i]);
+    }
+    _root = nodes.front();
+    return nodes.size();
+  }
+
+  /// Rebuilds the hierarchy from species delivered in post-order (children
+  /// before their parent) along with their depth, in linear time
+  struct PostOrderLinker {
+    /// Species (and their depth) whose parent is not known yet
+    std::vector<std::pair<uint, Node_ptr>> pending;
+
+    /// Attaches the pending species one level below \p n as its children
+    void operator() (const Node_ptr &n, uint depth) {
+      auto it = pending.end();
+      while (it != pending.begin() && std::prev(it)->first == depth+1) --it;
+      for (auto c = it; c != pending.end(); ++c)  n->addChild(c->second);
+      pending.erase(it, pending.end());
+      pending.emplace_back(depth, n);
+    }
+
+    /// \returns the root (last species delivered at depth 0), if any
+    Node_ptr root (void) const {
+      if (pending.empty() || pending.back().first != 0)  return nullptr;
+      return pending.back().second;
+    }
+  };
+
+  /// \returns a single node (ignoring its children) rebuilt from the contents
+  /// of json \p j. Does not touch the tree (safe to call concurrently).
+  /// In lazy mode, the enveloppe is moved out of \p j if it is an rvalue
+  template <typename J>
+  static Node_ptr decodeNode (J &&j, LoadMode mode) {
     Contributors c (j["id"], j["contribs"]);
     Node_ptr n = Node::make_shared(c);
 
-    _nodes[n->id()] = n;
-
     n->data = j["data"];
-    n->rset = j["envlp"].get<decltype(Node::rset)>();
+    n->userData.reserve(j["envlp"].size());
+    for (const json &je: j["envlp"]) {
+      n->userData.push_back(std::make_unique<UserData>(GID::INVALID));
+      *n->userData.back() = je[1].template get<UserData>();
+    }
+
+    if (mode == LoadMode::LAZY) {
+      json envlp;
+      if constexpr (std::is_lvalue_reference<J>::value)
+        envlp = j["envlp"];
+      else
+        envlp = std::move(j["envlp"]);
+
+      size_t size = envlp.size();
+      n->rset = decltype(n->rset)::deferred(
+        [envlp = std::move(envlp)] {
+          return envlp.get<typename Node::RSet>();
+        }, size);
+
+    } else
+      n->rset = j["envlp"].template get<typename Node::RSet>();
     const json &jd = j["dists"];
-    const json &jc = j["children"];
 
     using op = _details::DistanceMap::key_type;
+    auto &dist = n->distances.mut();
     for (const auto &d: jd)
-      n->distances[op{d[0], d[1]}] = d[2];
-
-    for (const auto &c: jc)
-      rebuildHierarchy(c);
+      dist[op{d[0], d[1]}] = d[2];
 
     return n;
   }
 
+  /// Registers (freshly decoded) node \p n and its representatives
+  void registerNode (const Node_ptr &n) {
+    _nodes[n->id()] = n;
+    indexRepresentatives(*n);
+  }
+
+  /// Deserialise the top-level fields of PTree \p pt (all but the hierarchy)
+  /// from json \p j
+  static void fromJsonHeader (const json &j, PhylogeneticTree &pt) {
+    pt._step = j["_step"];
+    pt._stillborns = j["_stillborns"];
+    pt._rsetSize = j["_envSize"];
+    if (Config::rsetSize() != pt._rsetSize)
+      utils::doThrow<std::invalid_argument>(
+        "Current configuration file specifies an enveloppe size of ",
+        Config::rsetSize(), " whereas the provided PTree was built with ",
+        pt._rsetSize);
+
+    pt._aliveSpecies = j["alive"].get<LivingSet>();
+    pt._nextNodeID = std::underlying_type<SID>::type(j["nextSID"].get<SID>());
+  }
+
+  /// Checks, in linear time, the hierarchy rebuilt from a saved tree (in
+  /// which \p species species were read) and marks the tree as clean.
+  ///
+  /// The serialized hierarchy and contributors (including their
+  /// elligibilities) are trusted, provided that all species are reachable
+  /// exactly once from the primordial species and that they are attached to
+  /// their main contributor. Throws std::invalid_argument otherwise
+  void finalizeHierarchy (size_t species) {
+    if (_nodes.size() != species)
+      utils::doThrow<std::invalid_argument>(
+        "Corrupted tree: ", species - _nodes.size(),
+        " duplicate species identifier(s)");
+
+    if (species > 0) {
+      if (!_root || _root->id() != SID(0) || _root->parent())
+        utils::doThrow<std::invalid_argument>(
+          "Corrupted tree: not rooted in the primordial species");
+
+      size_t reached = 0;
+      std::vector<const Node*> stack { _root.get() };
+      while (!stack.empty() && reached <= species) {
+        const Node *n = stack.back();
+        stack.pop_back();
+        reached++;
+
+        if (const Node *p = n->parent()) {
+          SID mc = n->contributors.currentMain();
+          if (mc != p->id())
+            utils::doThrow<std::invalid_argument>(
+              "Corrupted tree: species ", n->id(), " is attached to ",
+              p->id(), " instead of its main contributor ", mc);
+        }
+
+        for (const Node_ptr &c: n->children())  stack.push_back(c.get());
+      }
+
+      if (reached != species)
+        utils::doThrow<std::invalid_argument>(
+          "Corrupted tree: ", reached, " species reachable from the"
+          " primordial species instead of ", species);
+    }
+
+    markClean();
+  }
+
 public:
 
   /// Serialise PTree \p pt into a json
@@ -936,36 +1673,715 @@ public:
     j["_envSize"] = pt._rsetSize;
     j["_stillborns"] = pt._stillborns;
     j["alive"] = pt._aliveSpecies;
-    j["tree"] = toJson(*pt._root);
-    j["nextSID"] = pt._nextNodeID;
+    j["tree"] = pt.hierarchyToJson();
+    j["nextSID"] = pt.nextNodeID();
   }
 
   /// Deserialise PTree \p pt from json \p j
-  /// \arg complete Whether to load all data required to resume a simulation
-  /// or only those used in displaying/analysing.
-  static void fromJson (const json &j, PhylogeneticTree &pt) {
-    pt._step = j["_step"];
-    pt._stillborns = j["_stillborns"];
-    pt._rsetSize = j["_envSize"];
+  /// \arg mode Whether to decode enveloppes right away or on first access
+  static void fromJson (const json &j, PhylogeneticTree &pt,
+                        LoadMode mode = LoadMode::EAGER) {
+    fromJsonHeader(j, pt);
+    pt._indexPending = (mode == LoadMode::LAZY);
+    pt.finalizeHierarchy(pt.rebuildHierarchy(j["tree"], mode));
+  }
+
+  /// Deserialise PTree \p pt from the json contents of stream \p is without
+  /// building the complete json document. Species are created as soon as
+  /// they are parsed.
+  ///
+  /// Parsed species are decoded by batches on the ThreadPool while parsing
+  /// goes on. Batches are registered in parsing order and only a bounded
+  /// number of them is in flight at any time.
+  /// \arg mode Whether to decode enveloppes right away or on first access
+  /// \see TreeSaxParser
+  static void fromJsonStream (std::istream &is, PhylogeneticTree &pt,
+                              LoadMode mode = LoadMode::EAGER) {
+    using Batch = std::vector<json>;
+    using Decoded = std::vector<Node_ptr>;
+
+    ThreadPool &pool = ThreadPool::global();
+    std::deque<std::pair<std::future<Decoded>, std::vector<uint>>> jobs;
+    Batch batch;
+    std::vector<uint> depths;
+    PostOrderLinker linker;
+    size_t species = 0;
+    pt._indexPending = (mode == LoadMode::LAZY);
+
+    const auto add = [&pt, &linker, &species] (const Node_ptr &n, uint depth) {
+      pt.registerNode(n);
+      linker(n, depth);
+      species++;
+    };
+    const auto drainOne = [&jobs, &add] {
+      Decoded nodes = jobs.front().first.get();
+      const std::vector<uint> &d = jobs.front().second;
+      for (uint i=0; i<nodes.size(); i++)  add(nodes[i], d[i]);
+      jobs.pop_front();
+    };
+    const auto submit = [&pool, &jobs, &batch, &depths, &drainOne, mode] {
+      jobs.emplace_back(pool.submit([b = std::move(batch), mode] {
+        Decoded nodes;
+        nodes.reserve(b.size());
+        for (const json &j: b)  nodes.push_back(decodeNode(j, mode));
+        return nodes;
+      }), std::move(depths));
+      batch.clear();
+      depths.clear();
+      while (jobs.size() > 2 * pool.size())  drainOne();
+    };
+
+    TreeSaxParser parser ([&pool, &batch, &depths, &add, &submit, mode]
+                          (json &&j, uint depth) {
+      if (pool.size() <= 1 || mode == LoadMode::LAZY)
+        add(decodeNode(std::move(j), mode), depth);
+
+      else {
+        batch.push_back(std::move(j));
+        depths.push_back(depth);
+        if (batch.size() >= SERIALIZATION_GRAIN)  submit();
+      }
+    });
+
+    bool parsed = json::sax_parse(is, &parser);
+    if (!batch.empty()) submit();
+    while (!jobs.empty()) drainOne();
+
+    if (!parsed)
+      utils::doThrow<std::invalid_argument>("Failed to parse tree");
+
+    fromJsonHeader(parser.header(), pt);
+    pt._root = linker.root();
+    pt.finalizeHierarchy(species);
+  }
+
+// =============================================================================
+// == Binary conversion
+
+  /// Serialise PTree \p pt in the binary layout described in binaryformat.h
+  /// \warning \p os must be seekable (the header is written last)
+  static void toBinary (std::ostream &os, const PhylogeneticTree &pt) {
+    toBinary(os, pt, pt.preorder(), nullptr);
+  }
+
+  /// Serialise the species of \p pt modified since its last checkpoint (see
+  /// saveDeltaTo) in the binary layout described in binaryformat.h
+  /// \warning \p os must be seekable (the header is written last)
+  static void deltaToBinary (std::ostream &os, const PhylogeneticTree &pt) {
+    std::vector<const Node*> nodes;
+    for (const Node *n: pt.preorder())  if (n->dirty)  nodes.push_back(n);
+    toBinary(os, pt, nodes, &pt._removedSpecies);
+  }
+
+private:
+  /// \returns the species in pre-order
+  std::vector<const Node*> preorder (void) const {
+    std::vector<const Node*> nodes, stack;
+    nodes.reserve(_nodes.size());
+    if (_root) stack.push_back(_root.get());
+    while (!stack.empty()) {
+      const Node *n = stack.back();
+      stack.pop_back();
+      nodes.push_back(n);
+      const auto &c = n->children();
+      for (auto it = c.rbegin(); it != c.rend(); ++it)  stack.push_back(it->get());
+    }
+    return nodes;
+  }
+
+  /// Serialise species \p nodes of \p pt in the binary layout described in
+  /// binaryformat.h. Produces a delta checkpoint if \p removed is not null
+  static void toBinary (std::ostream &os, const PhylogeneticTree &pt,
+                        const std::vector<const Node*> &nodes,
+                        const std::vector<SID> *removed) {
+    using namespace binary;
+    using SID_ut = std::underlying_type<SID>::type;
+
+    const auto start = os.tellp();
+    const auto offset = [&os, start] { return uint64_t(os.tellp() - start); };
+
+    Header h = Header::make();
+    if (removed) {
+      h.flags |= DELTA;
+      h.baseStep = pt._checkpointStep;
+    }
+    h.rsetSize = pt._rsetSize;
+    h.step = pt._step;
+    h.stillborns = pt._stillborns;
+    h.nextSID = SID_ut(pt.nextNodeID());
+    h.nodes = nodes.size();
+    write(os, &h);
+    pad(os);
+
+    h.aliveOffset = offset();
+    for (SID sid: pt._aliveSpecies) {
+      uint32_t v = SID_ut(sid);
+      write(os, &v);
+      h.alive++;
+    }
+    pad(os);
+
+    h.childrenOffset = offset();
+    for (const Node *n: nodes) {
+      for (const Node_ptr &c: n->children()) {
+        uint32_t v = SID_ut(c->id());
+        write(os, &v);
+        h.children++;
+      }
+    }
+    pad(os);
+
+    h.contributorsOffset = offset();
+    for (const Node *n: nodes) {
+      for (const Contributor &c: n->contributors) {
+        ContributorRecord r { SID_ut(c.speciesID()), c.count(), c.elligible() };
+        write(os, &r);
+        h.contributors++;
+      }
+    }
+    pad(os);
+
+    h.distancesOffset = offset();
+    for (const Node *n: nodes) {
+      for (const auto &d: *n->distances) {
+        DistanceRecord r { d.first.first, d.first.second, d.second };
+        write(os, &r);
+        h.distances++;
+      }
+    }
+    pad(os);
+
+    // Representatives are encoded in parallel, by contiguous ranges of
+    // species, and written in order. Only a window of species is held in
+    // memory at any time
+    h.blobsOffset = offset();
+    std::vector<uint64_t> blobOffsets (nodes.size());
+    ThreadPool &pool = ThreadPool::global();
+    const size_t window = 4 * pool.size() * SERIALIZATION_GRAIN;
+    std::vector<std::string> blobs;
+    for (size_t w=0; w<nodes.size(); w+=window) {
+      blobs.resize(std::min(window, nodes.size() - w));
+      pool.parallelFor(blobs.size(), SERIALIZATION_GRAIN,
+                       [&nodes, &blobs, w] (size_t b, size_t e) {
+        std::ostringstream oss;
+        for (size_t i=b; i<e; i++) {
+          oss.str("");
+          writeRepresentatives(oss, *nodes[w+i]);
+          blobs[i] = oss.str();
+        }
+      });
+      for (size_t i=0; i<blobs.size(); i++) {
+        blobOffsets[w+i] = offset() - h.blobsOffset;
+        os.write(blobs[i].data(), blobs[i].size());
+      }
+    }
+    pad(os);
+
+    h.nodesOffset = offset();
+    uint32_t children = 0, contributors = 0, distances = 0;
+    for (uint i=0; i<nodes.size(); i++) {
+      const Node &n = *nodes[i];
+      const SpeciesData &d = n.data;
+
+      NodeRecord r {};
+      r.sid = SID_ut(n.id());
+      r.parent = SID_ut(n.parent() ? n.parent()->id() : SID::INVALID);
+      r.firstAppearance = d.firstAppearance;
+      r.lastAppearance = d.lastAppearance;
+      r.count = d.count;
+      r.currentlyAlive = d.currentlyAlive;
+      r.pendingCandidates = d.pendingCandidates;
+      r.rsetSize = n.rset->size();
+      r.firstChild = children;
+      r.childrenCount = n.children().size();
+      r.firstContributor = contributors;
+      r.contributorsCount = n.contributors.data().size();
+      r.firstDistance = distances;
+      r.distancesCount = n.distances->size();
+      r.blobOffset = blobOffsets[i];
+      write(os, &r);
+
+      children += r.childrenCount;
+      contributors += r.contributorsCount;
+      distances += r.distancesCount;
+    }
+    pad(os);
+
+    h.indexOffset = offset();
+    std::vector<IndexRecord> index;
+    index.reserve(nodes.size());
+    for (uint i=0; i<nodes.size(); i++)
+      index.push_back({SID_ut(nodes[i]->id()), i});
+    std::sort(index.begin(), index.end(),
+              [] (const IndexRecord &lhs, const IndexRecord &rhs) {
+      return lhs.sid < rhs.sid;
+    });
+    write(os, index.data(), index.size());
+    pad(os);
+
+    h.removedOffset = offset();
+    if (removed) {
+      for (SID sid: *removed) {
+        uint32_t v = SID_ut(sid);
+        write(os, &v);
+        h.removed++;
+      }
+    }
+
+    const auto end = os.tellp();
+    os.seekp(start);
+    write(os, &h);
+    os.seekp(end);
+  }
+
+public:
+
+  /// Deserialise PTree \p pt from the binary layout in \p is
+  /// \arg mode Whether to decode enveloppes right away or on first access
+  /// \warning \p is must be seekable
+  static void fromBinary (std::istream &is, PhylogeneticTree &pt,
+                          LoadMode mode = LoadMode::EAGER) {
+    using namespace binary;
+
+    const auto start = is.tellg();
+    const auto section = [&is, start] (uint64_t offset) {
+      is.seekg(start + std::streamoff(offset));
+    };
+
+    Header h;
+    read(is, &h);
+    h.validate();
+    if (h.flags & DELTA)
+      utils::doThrow<std::invalid_argument>(
+        "Cannot load a delta checkpoint on its own. Use applyDelta() on top of"
+        " the checkpoint at step ", h.baseStep);
+
+    pt._step = h.step;
+    pt._stillborns = h.stillborns;
+    pt._rsetSize = h.rsetSize;
     if (Config::rsetSize() != pt._rsetSize)
       utils::doThrow<std::invalid_argument>(
         "Current configuration file specifies an enveloppe size of ",
         Config::rsetSize(), " whereas the provided PTree was built with ",
         pt._rsetSize);
 
-    pt._root = pt.rebuildHierarchy(j["tree"]);
-    pt._aliveSpecies = j["alive"].get<LivingSet>();
-    pt._nextNodeID = j["nextSID"];
+    std::vector<NodeRecord> records (h.nodes);
+    std::vector<uint32_t> alive (h.alive), children (h.children);
+    std::vector<ContributorRecord> contributors (h.contributors);
+    std::vector<DistanceRecord> distances (h.distances);
+
+    section(h.nodesOffset);
+    read(is, records.data(), records.size());
+    section(h.aliveOffset);
+    read(is, alive.data(), alive.size());
+    section(h.childrenOffset);
+    read(is, children.data(), children.size());
+    section(h.contributorsOffset);
+    read(is, contributors.data(), contributors.size());
+    section(h.distancesOffset);
+    read(is, distances.data(), distances.size());
+
+    pt._indexPending = (mode == LoadMode::LAZY);
+    for (const Node_ptr &n: readNodes(is, start, h, records, contributors,
+                                      distances, mode))
+      pt.registerNode(n);
+
+    for (const NodeRecord &r: records) {
+      const Node_ptr &n = pt._nodes.at(SID(r.sid));
+      for (uint i=0; i<r.childrenCount; i++)
+        n->addChild(pt._nodes.at(SID(children[r.firstChild + i])));
+    }
 
-    // Ensure correct parenting
-    for (auto &n: pt._nodes)
-      pt.updateContributions(n.second, {}, true);
+    pt._root = records.empty() ? nullptr : pt._nodes.at(SID(records[0].sid));
+    for (uint32_t sid: alive) pt._aliveSpecies.insert(SID(sid));
+    pt._nextNodeID = h.nextSID;
+    pt.finalizeHierarchy(records.size());
+  }
 
-#ifndef NDEBUG
-    pt.checkMC();
-#endif
+  /// Applies the delta checkpoint in \p is (see deltaToBinary) on top of
+  /// \p pt which must be in the state of the checkpoint it was based on.
+  /// Throws std::invalid_argument otherwise
+  /// \warning \p is must be seekable
+  static void applyDelta (std::istream &is, PhylogeneticTree &pt) {
+    using namespace binary;
+
+    const auto start = is.tellg();
+    const auto section = [&is, start] (uint64_t offset) {
+      is.seekg(start + std::streamoff(offset));
+    };
+
+    Header h;
+    read(is, &h);
+    h.validate();
+    if (!(h.flags & DELTA))
+      utils::doThrow<std::invalid_argument>("Not a delta checkpoint");
+    if (h.baseStep != pt._step)
+      utils::doThrow<std::invalid_argument>(
+        "Delta checkpoint applies to step ", h.baseStep,
+        " whereas the tree is at step ", pt._step);
+    if (h.rsetSize != pt._rsetSize)
+      utils::doThrow<std::invalid_argument>(
+        "Delta checkpoint has an enveloppe size of ", h.rsetSize,
+        " whereas the tree was built with ", pt._rsetSize);
+
+    std::vector<NodeRecord> records (h.nodes);
+    std::vector<uint32_t> alive (h.alive), children (h.children),
+                          removed (h.removed);
+    std::vector<ContributorRecord> contributors (h.contributors);
+    std::vector<DistanceRecord> distances (h.distances);
+
+    section(h.nodesOffset);
+    read(is, records.data(), records.size());
+    section(h.aliveOffset);
+    read(is, alive.data(), alive.size());
+    section(h.childrenOffset);
+    read(is, children.data(), children.size());
+    section(h.contributorsOffset);
+    read(is, contributors.data(), contributors.size());
+    section(h.distancesOffset);
+    read(is, distances.data(), distances.size());
+    section(h.removedOffset);
+    read(is, removed.data(), removed.size());
+
+    // Update modified species in place (unmodified children point to them)
+    for (Node_ptr n: readNodes(is, start, h, records, contributors,
+                               distances)) {
+      auto it = pt._nodes.find(n->id());
+      if (it == pt._nodes.end()) {
+        pt._nodes[n->id()] = n;
+
+      } else {
+        Node &e = *it->second;
+        pt.unindexRepresentatives(e);
+        e.data = n->data;
+        e.contributors = n->contributors;
+        e.rset = n->rset;
+        e.userData = std::move(n->userData);
+        e.distances = n->distances;
+        e.clearChildren();
+        n = it->second;
+      }
+      pt.indexRepresentatives(*n);
+    }
+
+    for (uint32_t sid: removed) {
+      auto it = pt._nodes.find(SID(sid));
+      if (it == pt._nodes.end())  continue;  // Created and removed in between
+      pt.unindexRepresentatives(*it->second);
+      pt._nodes.erase(it);
+    }
+
+    // Modified species hold their complete list of subspecies
+    for (const NodeRecord &r: records) {
+      const Node_ptr &n = pt._nodes.at(SID(r.sid));
+      for (uint i=0; i<r.childrenCount; i++)
+        n->addChild(pt._nodes.at(SID(children[r.firstChild + i])));
+    }
+
+    auto root = pt._nodes.find(SID(0));
+    pt._root = (root != pt._nodes.end()) ? root->second : nullptr;
+
+    // Species alive in both checkpoints are not saved again: bring their
+    // last appearance up to date
+    pt._aliveSpecies.clear();
+    for (uint32_t sid: alive) {
+      pt._aliveSpecies.insert(SID(sid));
+      pt.nodeAt(SID(sid))->data.lastAppearance = h.step;
+    }
+    pt._step = h.step;
+    pt._stillborns = h.stillborns;
+    pt._nextNodeID = h.nextSID;
+    pt.finalizeHierarchy(pt._nodes.size());
   }
 
+  /// \returns the species \p sid read from the binary layout in \p is
+  /// (starting at the current position), without its parent and children.
+  /// Only the header, O(log n) index entries and the species' own records are
+  /// read.
+  /// Throws std::invalid_argument if no such species exists
+  /// \warning \p is must be seekable
+  static Node_ptr speciesFromBinary (std::istream &is, SID sid) {
+    using namespace binary;
+
+    const auto start = is.tellg();
+    Header h;
+    read(is, &h);
+    h.validate();
+
+    return readNode(is, start, h, findRecord(is, start, h, sid));
+  }
+
+  /// Deserialise, into \p pt, the lineage of species \p sid (i.e. the path
+  /// from the primordial species to \p sid) from the binary layout in \p is.
+  /// Each species on the path only has its successor on the path as child.
+  /// Only the header, O(log n) index entries per species and the lineage's
+  /// own records are read.
+  /// Throws std::invalid_argument if no such species exists
+  /// \warning \p is must be seekable
+  /// \warning The resulting tree is meant for inspection: it is not suited
+  /// for further insertions
+  static void lineageFromBinary (std::istream &is, SID sid,
+                                 PhylogeneticTree &pt) {
+    using namespace binary;
+
+    const auto start = is.tellg();
+    Header h;
+    read(is, &h);
+    h.validate();
+
+    pt._step = h.step;
+    pt._stillborns = h.stillborns;
+    pt._rsetSize = h.rsetSize;
+    pt._nextNodeID = h.nextSID;
+
+    Node_ptr child = nullptr;
+    while (sid != SID::INVALID) {
+      NodeRecord r = findRecord(is, start, h, sid);
+      Node_ptr n = readNode(is, start, h, r);
+      if (child)  n->addChild(child);
+
+      pt._nodes[n->id()] = n;
+      pt.indexRepresentatives(*n);
+
+      uint32_t alive;
+      if (find(is, start + std::streamoff(h.aliveOffset), h.alive, r.sid,
+               [] (uint32_t v) { return v; }, alive))
+        pt._aliveSpecies.insert(sid);
+
+      child = n;
+      sid = SID(r.parent);
+    }
+    pt._root = child;
+  }
+
+private:
+  /// \returns the record for species \p sid in the binary layout starting at
+  /// \p start in \p is (described by \p h).
+  /// Throws std::invalid_argument if no such species exists
+  static binary::NodeRecord findRecord (std::istream &is, std::streampos start,
+                                        const binary::Header &h, SID sid) {
+    using namespace binary;
+    using SID_ut = std::underlying_type<SID>::type;
+
+    IndexRecord i;
+    if (!find(is, start + std::streamoff(h.indexOffset), h.nodes, SID_ut(sid),
+              [] (const IndexRecord &r) { return r.sid; }, i))
+      utils::doThrow<std::invalid_argument>("No species ", sid,
+                                            " in binary tree");
+
+    NodeRecord r;
+    is.seekg(start + std::streamoff(h.nodesOffset + i.node * sizeof(r)));
+    read(is, &r);
+    return r;
+  }
+
+  /// \returns the species described by \p r, without its hierarchy, from the
+  /// binary layout starting at \p start in \p is (described by \p h).
+  /// \p contributors and \p distances point to the species' own records
+  /// when already loaded and are otherwise read from \p is.
+  static Node_ptr readNode (std::istream &is, std::streampos start,
+                            const binary::Header &h,
+                            const binary::NodeRecord &r,
+                            const binary::ContributorRecord *contributors
+                              = nullptr,
+                            const binary::DistanceRecord *distances
+                              = nullptr) {
+    using namespace binary;
+
+    const auto section = [&is, start] (uint64_t offset) {
+      is.seekg(start + std::streamoff(offset));
+    };
+
+    std::vector<ContributorRecord> ownContributors;
+    if (!contributors) {
+      ownContributors.resize(r.contributorsCount);
+      section(h.contributorsOffset
+              + r.firstContributor * sizeof(ContributorRecord));
+      read(is, ownContributors.data(), ownContributors.size());
+      contributors = ownContributors.data();
+    }
+
+    std::vector<DistanceRecord> ownDistances;
+    if (!distances) {
+      ownDistances.resize(r.distancesCount);
+      section(h.distancesOffset + r.firstDistance * sizeof(DistanceRecord));
+      read(is, ownDistances.data(), ownDistances.size());
+      distances = ownDistances.data();
+    }
+
+    Node_ptr n = recordToNode(r, contributors, distances);
+    section(h.blobsOffset + r.blobOffset);
+    typename Node::RSet rset;
+    readRepresentatives(is, r.rsetSize, &rset, &n->userData);
+    n->rset = std::move(rset);
+    return n;
+  }
+
+  /// \returns the species described by \p records, without their hierarchy,
+  /// from the binary layout starting at \p start in \p is (described by
+  /// \p h). \p contributors and \p distances are the corresponding (already
+  /// loaded) sections.
+  ///
+  /// The representatives section is read at once and decoded in parallel, by
+  /// contiguous ranges of species (see ThreadPool). In lazy mode, it is
+  /// instead shared by all species which decode their own genomes on first
+  /// access
+  static std::vector<Node_ptr>
+  readNodes (std::istream &is, std::streampos start, const binary::Header &h,
+             const std::vector<binary::NodeRecord> &records,
+             const std::vector<binary::ContributorRecord> &contributors,
+             const std::vector<binary::DistanceRecord> &distances,
+             LoadMode mode = LoadMode::EAGER) {
+    using namespace binary;
+
+    if (h.nodesOffset < h.blobsOffset)
+      utils::doThrow<std::invalid_argument>("Corrupted binary tree");
+
+    auto blobs = std::make_shared<std::string>(h.nodesOffset - h.blobsOffset,
+                                               '\0');
+    is.seekg(start + std::streamoff(h.blobsOffset));
+    read(is, blobs->data(), blobs->size());
+
+    using RSet = typename Node::RSet;
+    using RSetPtr = decltype(Node::rset);
+    using UserDataSet = typename Node::UserDataSet;
+    const auto decode = [] (const std::string &blobs, uint64_t offset,
+                            uint count, RSet *rset, UserDataSet *userData) {
+      MemoryBuf buffer (blobs.data(), blobs.size());
+      std::istream is (&buffer);
+      is.seekg(offset);
+      readRepresentatives(is, count, rset, userData);
+    };
+
+    std::vector<Node_ptr> nodes (records.size());
+    ThreadPool::global().parallelFor(records.size(), SERIALIZATION_GRAIN,
+                                     [&] (size_t b, size_t e) {
+      for (size_t i=b; i<e; i++) {
+        const NodeRecord &r = records[i];
+        if (uint64_t(r.firstContributor) + r.contributorsCount
+              > contributors.size()
+            || uint64_t(r.firstDistance) + r.distancesCount > distances.size()
+            || r.blobOffset > blobs->size())
+          utils::doThrow<std::invalid_argument>(
+            "Corrupted binary tree (species ", r.sid, ")");
+
+        nodes[i] = recordToNode(r, contributors.data() + r.firstContributor,
+                                distances.data() + r.firstDistance);
+        // User data is always decoded: it is owned by the node (see
+        // Node::userData) while the genomes can be shared
+        if (mode == LoadMode::LAZY) {
+          decode(*blobs, r.blobOffset, r.rsetSize, nullptr,
+                 &nodes[i]->userData);
+          nodes[i]->rset = RSetPtr::deferred(
+            [decode, blobs, offset = r.blobOffset, count = r.rsetSize] {
+              RSet rset;
+              decode(*blobs, offset, count, &rset, nullptr);
+              return rset;
+            }, r.rsetSize);
+
+        } else {
+          RSet rset;
+          decode(*blobs, r.blobOffset, r.rsetSize, &rset, &nodes[i]->userData);
+          nodes[i]->rset = std::move(rset);
+        }
+      }
+    });
+    return nodes;
+  }
+
+  /// \returns the species described by \p r (and its own \p contributors and
+  /// \p distances records) without its hierarchy nor representatives
+  static Node_ptr recordToNode (const binary::NodeRecord &r,
+                                const binary::ContributorRecord *contributors,
+                                const binary::DistanceRecord *distances) {
+    std::vector<Contributor> contribs;
+    contribs.reserve(r.contributorsCount);
+    for (uint i=0; i<r.contributorsCount; i++) {
+      const binary::ContributorRecord &c = contributors[i];
+      contribs.emplace_back(SID(c.sid), c.count, c.elligible);
+    }
+
+    Contributors c (SID(r.sid), std::move(contribs));
+    Node_ptr n = Node::make_shared(c);
+    n->data = SpeciesData { r.firstAppearance, r.lastAppearance, r.count,
+                            r.currentlyAlive, r.pendingCandidates };
+
+    using op = _details::DistanceMap::key_type;
+    auto &dist = n->distances.mut();
+    for (uint i=0; i<r.distancesCount; i++) {
+      const binary::DistanceRecord &d = distances[i];
+      dist[op{d.i, d.j}] = d.d;
+    }
+
+    return n;
+  }
+
+  /// Writes the enveloppe points of \p n (genomes and user data) in the
+  /// representatives section of the binary layout
+  static void writeRepresentatives (std::ostream &os, const Node &n) {
+    using namespace binary;
+
+    std::vector<uint8_t> bytes;
+    const auto writeBytes = [&os, &bytes] {
+      uint32_t size = bytes.size();
+      write(os, &size);
+      write(os, bytes.data(), size);
+    };
+
+    const typename Node::RSet &rset = *n.rset;
+    for (uint i=0; i<rset.size(); i++) {
+      uint32_t timestamp = rset[i].timestamp;
+      write(os, &timestamp);
+      Serializer<Genome>::toBytes(rset[i].genome, bytes);
+      writeBytes();
+      Serializer<UserData>::toBytes(*n.userData[i], bytes);
+      writeBytes();
+    }
+  }
+
+  /// Reads \p count enveloppe points from the representatives section of the
+  /// binary layout in \p is (at the current position). Genomes are appended
+  /// to \p rset and user data to \p userData, either of which can be null to
+  /// skip the corresponding decoding
+  static void readRepresentatives (std::istream &is, uint count,
+                                   typename Node::RSet *rset,
+                                   typename Node::UserDataSet *userData) {
+    using namespace binary;
+
+    std::vector<uint8_t> bytes;
+    const auto readBytes = [&is, &bytes] (bool decode) {
+      uint32_t size;
+      read(is, &size);
+      if (decode) {
+        bytes.resize(size);
+        read(is, bytes.data(), size);
+      } else
+        is.seekg(size, std::ios::cur);
+    };
+
+    if (rset)     rset->reserve(count);
+    if (userData) userData->reserve(count);
+    for (uint i=0; i<count; i++) {
+      uint32_t timestamp;
+      read(is, &timestamp);
+
+      readBytes(rset);
+      if (rset) {
+        Genome g;
+        Serializer<Genome>::fromBytes(bytes, g);
+        rset->push_back(Node::Representative::make(g));
+        rset->back().timestamp = timestamp;
+      }
+
+      readBytes(userData);
+      if (userData) {
+        userData->push_back(std::make_unique<UserData>(GID::INVALID));
+        Serializer<UserData>::fromBytes(bytes, *userData->back());
+      }
+    }
+  }
+
+public:
   /// Asserts that two phylogenetic trees are equal
   friend void assertEqual (const PhylogeneticTree &lhs,
                            const PhylogeneticTree &rhs, bool deepcopy) {
@@ -974,23 +2390,27 @@ public:
     assertEqual(lhs._nodes, rhs._nodes, deepcopy);
     assertEqual(lhs._aliveSpecies, rhs._aliveSpecies, deepcopy);
 
-    assertEqual(lhs._nextNodeID, rhs._nextNodeID, deepcopy);
+    assertEqual(lhs.nextNodeID(), rhs.nextNodeID(), deepcopy);
     assertEqual(lhs._rsetSize, rhs._rsetSize, deepcopy);
     assertEqual(lhs._stillborns, rhs._stillborns, deepcopy);
     assertEqual(lhs._step, rhs._step, deepcopy);
   }
 
-  /// Stores itself at the given location
+  /// Stores itself at the given location. The file is compressed if its
+  /// extension is compression::EXTENSION
   bool saveTo (const stdfs::path &filename) const {
-    std::ofstream ofs (filename);
-    if (!ofs) {
-      std::cerr << "Unable to open '" << filename << "' for writing"
-                << std::endl;
-      return false;
-    }
+    return saveTo(filename, compression::compressed(filename));
+  }
 
-    saveTo(ofs, -1);
-    return true;
+  /// Stores itself at the given location, compressed if \p compress
+  bool saveTo (const stdfs::path &filename, bool compress) const {
+    APT_TRACE("saveTo");
+    auto os = openOutput(filename, compress);
+    if (!os)  return false;
+
+    saveTo(*os, -1);
+    os->flush();
+    return bool(*os);
   }
 
   /// Stores itself in the provided stream
@@ -1000,19 +2420,230 @@ public:
     os << j.dump(ident);
   }
 
-  /// \returns a phylogenic tree rebuilt from data at the given location
-  static PhylogeneticTree readFrom (const std::string &filename) {
-    std::ifstream ifs (filename);
+  /// Stores itself at the given location from a background thread.
+  ///
+  /// Only a copy of the hierarchy and user data is made on the calling thread
+  /// (O(species + enveloppe points), genomes and distances being copy-on-write
+  /// and the lookup table skipped),
+  /// serialization and I/O are deferred. The file is written under a
+  /// temporary name and renamed once complete so that an interrupted
+  /// checkpoint never overwrites a valid one.
+  /// At most one save is in flight: this call first waits for the previous
+  /// one, if any, to complete.
+  ///
+  /// \returns a future holding whether the save was successful
+  std::shared_future<bool> saveToAsync (const stdfs::path &filename) const {
+    if (_pendingSave.valid()) _pendingSave.wait();
+
+    // The save never looks genomes up: skip the lookup table
+    std::shared_ptr<const PhylogeneticTree> copy (
+      new PhylogeneticTree(*this, false));
+    _pendingSave = std::async(std::launch::async, [copy, filename] {
+      stdfs::path tmp = filename;
+      tmp += ".tmp";
+      if (!copy->saveTo(tmp, compression::compressed(filename))) return false;
+
+      std::error_code ec;
+      stdfs::rename(tmp, filename, ec);
+      if (ec)
+        std::cerr << "Unable to move '" << tmp << "' to '" << filename
+                  << "': " << ec.message() << std::endl;
+      return !ec;
+    }).share();
+
+    return _pendingSave;
+  }
+
+  /// Stores itself at the given location in the binary format. The file is
+  /// compressed if its extension is compression::EXTENSION
+  bool saveBinaryTo (const stdfs::path &filename) const {
+    APT_TRACE("saveBinaryTo");
+    return writeBinary(filename, [this] (std::ostream &os) {
+      toBinary(os, *this);
+    });
+  }
+
+  /// Marks all species as unmodified: the next delta checkpoint (see
+  /// saveDeltaTo) will be relative to the current state.
+  /// Call right after saving the base checkpoint of a delta chain
+  void markClean (void) {
+    for (auto &p: _nodes) p.second->dirty = false;
+    _removedSpecies.clear();
+    _checkpointStep = _step;
+  }
+
+  /// Stores, at the given location, only the species created, modified or
+  /// removed since the last checkpoint (base or delta) and marks the tree as
+  /// clean on success.
+  ///
+  /// \see markClean
+  /// \see readFrom(const std::string&, const std::vector<std::string>&)
+  bool saveDeltaTo (const stdfs::path &filename) {
+    APT_TRACE("saveDeltaTo");
+    bool ok = writeBinary(filename, [this] (std::ostream &os) {
+      deltaToBinary(os, *this);
+    });
+    if (ok) markClean();
+    return ok;
+  }
+
+  /// \returns a phylogenic tree rebuilt from data at the given location.
+  /// Both the json and binary formats are accepted (detected automatically),
+  /// compressed or not (see compression::EXTENSION)
+  ///
+  /// In lazy mode, genomes and user data are only decoded when an enveloppe
+  /// is first accessed (e.g. to inspect a species), which is much faster and
+  /// lighter when only the hierarchy and species data are needed (viewing,
+  /// statistics). Looking up a representative (see representative()) decodes
+  /// all enveloppes.
+  static PhylogeneticTree readFrom (const std::string &filename,
+                                    LoadMode mode = LoadMode::EAGER) {
+    auto is = openInput(filename);
+
+    PhylogeneticTree pt;
+    if (!binary::isBinary(*is))
+      fromJsonStream(*is, pt, mode);
+
+    else if (compression::compressed(filename))
+      fromBinary(*openInput(filename, true), pt, mode);
+
+    else
+      fromBinary(*is, pt, mode);
+
+    return pt;
+  }
+
+  /// \returns a phylogenic tree rebuilt from the checkpoint at \p base (in
+  /// any format, decoded according to \p mode) and the chain of delta
+  /// checkpoints \p deltas applied in order
+  /// \see saveDeltaTo
+  static PhylogeneticTree readFrom (const std::string &base,
+                                    const std::vector<std::string> &deltas,
+                                    LoadMode mode = LoadMode::EAGER) {
+    PhylogeneticTree pt = readFrom(base, mode);
+    for (const std::string &d: deltas)  applyDelta(*openInput(d, true), pt);
+    return pt;
+  }
+
+  /// \returns the species \p sid from the binary tree at the given location,
+  /// without reading the rest of the file.
+  /// Throws std::invalid_argument if the file is not a binary tree (see
+  /// convert()) or does not contain \p sid
+  /// \see speciesFromBinary
+  static Node_ptr readSpeciesFrom (const std::string &filename, SID sid) {
+    return readIndexed(filename, [sid] (std::istream &is) {
+      return speciesFromBinary(is, sid);
+    });
+  }
+
+  /// \returns the lineage of \p sid (path from the primordial species) from
+  /// the binary tree at the given location, without reading the rest of the
+  /// file.
+  /// Throws std::invalid_argument if the file is not a binary tree (see
+  /// convert()) or does not contain \p sid
+  /// \see lineageFromBinary
+  static PhylogeneticTree readLineageFrom (const std::string &filename,
+                                           SID sid) {
+    return readIndexed(filename, [sid] (std::istream &is) {
+      PhylogeneticTree pt;
+      lineageFromBinary(is, sid, pt);
+      return pt;
+    });
+  }
+
+  /// Converts the tree stored at \p input into the other format (binary to
+  /// json or json to binary) and stores the result at \p output
+  static bool convert (const std::string &input, const stdfs::path &output) {
+    bool binary = binary::isBinary(*openInput(input));
+
+    PhylogeneticTree pt = readFrom(input);
+    return binary ? pt.saveTo(output) : pt.saveBinaryTo(output);
+  }
+
+private:
+  /// Opens \p filename, ensures that it is a binary tree and \returns the
+  /// result of \p reader on it
+  template <typename F>
+  static auto readIndexed (const std::string &filename, F reader) {
+    if (compression::compressed(filename))
+      throw std::invalid_argument ("'" + filename + "' is compressed: single"
+                                   " species can only be read from"
+                                   " uncompressed binary trees");
+
+    std::ifstream ifs (filename, std::ios::binary);
     if (!ifs)
       throw std::invalid_argument ("Unable to open '" + filename
                                    + "' for reading");
 
-    else {
-      PhylogeneticTree pt;
-      json j = json::parse(utils::readAll(filename));
-      fromJson(j, pt);
-      return pt;
+    if (!binary::isBinary(ifs))
+      throw std::invalid_argument ("'" + filename + "' is not a binary tree:"
+                                   " single species can only be read from"
+                                   " the binary format");
+
+    return reader(ifs);
+  }
+
+  /// \returns a stream writing to \p filename (compressed if \p compress)
+  /// or null if the file cannot be opened
+  static std::unique_ptr<std::ostream> openOutput (const stdfs::path &filename,
+                                                   bool compress) {
+    std::unique_ptr<std::ostream> os;
+    if (compress)
+      os = std::make_unique<compression::OStream>(filename);
+    else
+      os = std::make_unique<std::ofstream>(filename, std::ios::binary);
+
+    if (!*os) {
+      std::cerr << "Unable to open '" << filename << "' for writing"
+                << std::endl;
+      os.reset();
     }
+    return os;
+  }
+
+  /// \returns a stream reading from \p filename, transparently decompressed
+  /// if needed (see compression::EXTENSION). If \p seekable, compressed
+  /// contents are decompressed in memory beforehand.
+  /// Throws std::invalid_argument if the file cannot be opened
+  static std::unique_ptr<std::istream> openInput (const std::string &filename,
+                                                  bool seekable = false) {
+    std::unique_ptr<std::istream> is;
+    if (!compression::compressed(filename))
+      is = std::make_unique<std::ifstream>(filename, std::ios::binary);
+    else
+      is = std::make_unique<compression::IStream>(filename);
+
+    if (!*is)
+      throw std::invalid_argument ("Unable to open '" + filename
+                                   + "' for reading");
+
+    if (seekable && compression::compressed(filename)) {
+      auto ss = std::make_unique<std::stringstream>();
+      *ss << is->rdbuf();
+      is = std::move(ss);
+    }
+    return is;
+  }
+
+  /// Writes the binary contents produced by \p writer into \p filename.
+  /// As the binary layout requires a seekable stream, compressed files are
+  /// first produced in memory
+  template <typename F>
+  static bool writeBinary (const stdfs::path &filename, F writer) {
+    if (!compression::compressed(filename)) {
+      auto os = openOutput(filename, false);
+      if (!os)  return false;
+      writer(*os);
+      return bool(*os);
+    }
+
+    std::stringstream ss;
+    writer(ss);
+    auto os = openOutput(filename, true);
+    if (!os)  return false;
+    *os << ss.rdbuf();
+    os->flush();
+    return bool(*os);
   }
 };
 
@@ -0,0 +1,213 @@
+#ifndef KGD_APOGET_SNAPSHOT_HPP
+#define KGD_APOGET_SNAPSHOT_HPP
+
+/*!
+ * \file snapshot.hpp
+ *
+ * Contains the definition of an immutable, epoch-stamped, view of a
+ * phylogenetic tree
+ */
+
+#include <memory>
+
+#include "speciesdata.hpp"
+
+namespace phylogeny {
+
+/// Immutable view of a phylogenetic tree at a given step (epoch).
+///
+/// Snapshots are published by the writer (see
+/// PhylogeneticTree::publishSnapshot) and acquired by readers through a
+/// shared pointer. As nothing in a snapshot is ever modified, readers need no
+/// locking and never block the writer.
+///
+/// Consecutive snapshots share everything that did not change in-between:
+/// species (as told by their modification stamp, see Node::touch), enveloppes
+/// and representatives are only copied when modified. Only the species
+/// collection itself, i.e. one pointer per species, is rebuilt every time.
+/// Replaced representatives and removed species are thus reclaimed once the
+/// last reader of the last snapshot referencing them lets go.
+template <typename GENOME>
+class TreeSnapshot {
+public:
+  /// Helper alias to a pointer to an immutable snapshot
+  using Ptr = std::shared_ptr<const TreeSnapshot>;
+
+  /// Frozen copy of an enveloppe point
+  struct Representative {
+    uint timestamp; ///< Insertion date
+    GENOME genome;  ///< The genome for this representant
+  };
+
+  /// Helper alias to a pointer to a shared representative
+  using Representative_ptr = std::shared_ptr<const Representative>;
+
+  /// Frozen copy of a species enveloppe
+  struct Enveloppe {
+    /// Representatives, in the same order as in the source species
+    std::vector<Representative_ptr> rset;
+
+    /// Intra-enveloppe distances
+    _details::DistanceMap distances;
+  };
+
+  /// Frozen copy of a species node
+  struct Species {
+    SID id;       ///< Species identificator
+    SID parent;   ///< Main contributor (SID::INVALID for the root)
+    std::vector<SID> children;  ///< Subspecies identificators
+    /// Species additional data
+    /// \warning data.lastAppearance is not kept up to date for alive species
+    /// (see TreeSnapshot::lastAppearance)
+    SpeciesData data;
+    uint64_t version;  ///< Modification stamp of the source node
+
+    /// Representatives and associated distances
+    std::shared_ptr<const Enveloppe> enveloppe;
+
+    /// \returns the genetic identificator of representative \p i
+    GID representativeId (uint i) const {
+      return enveloppe->rset[i]->genome.genealogy().self.gid;
+    }
+  };
+
+  /// Helper alias to a pointer to a shared species
+  using Species_ptr = std::shared_ptr<const Species>;
+
+  /// Helper alias to the species collection
+  using Collection = std::map<SID, Species_ptr>;
+
+  /// \returns the step at which this snapshot was taken
+  uint epoch (void) const {
+    return _epoch;
+  }
+
+  /// \returns the identificator of the root species (SID::INVALID if empty)
+  SID root (void) const {
+    return _root;
+  }
+
+  /// \returns the number of species in this snapshot
+  uint width (void) const {
+    return _species.size();
+  }
+
+  /// \returns all the species in this snapshot
+  const Collection& species (void) const {
+    return _species;
+  }
+
+  /// \returns the species with \p sid
+  const Species& at (SID sid) const {
+    auto it = _species.find(sid);
+    if (it == _species.end())
+      utils::doThrow<std::invalid_argument>("No species ", sid, " in snapshot",
+                                            " of epoch ", _epoch);
+    return *it->second;
+  }
+
+  /// \returns the species alive at the time of this snapshot
+  const LivingSet& aliveSpecies (void) const {
+    return _alive;
+  }
+
+  /// \returns the last step at which species \p s was seen alive
+  uint lastAppearance (const Species &s) const {
+    return _alive.count(s.id) ? _epoch : s.data.lastAppearance;
+  }
+
+  /// Captures the current state of \p nodes, sharing unchanged items with
+  /// \p previous (if any).
+  ///
+  /// \tparam NODES a PhylogeneticTree::Nodes collection
+  template <typename NODES>
+  static Ptr capture (uint epoch, SID root, const NODES &nodes,
+                      const LivingSet &alive, const Ptr &previous) {
+    auto s = std::make_shared<TreeSnapshot>();
+    s->_epoch = epoch;
+    s->_root = root;
+    s->_alive = alive;
+
+    // Both collections are sorted by SID: walk them in lockstep
+    typename Collection::const_iterator it, end;
+    if (previous) {
+      it = previous->_species.begin();
+      end = previous->_species.end();
+    }
+
+    for (const auto &p: nodes) {
+      const auto &n = *p.second;
+
+      const Species *old = nullptr;
+      if (previous) {
+        while (it != end && it->first < n.id()) ++it;
+        if (it != end && it->first == n.id()) {
+          if (it->second->version == n.version) {
+            s->_species.emplace_hint(s->_species.end(), n.id(), it->second);
+            continue;
+          }
+          old = it->second.get();
+        }
+      }
+
+      auto sp = std::make_shared<Species>();
+      sp->id = n.id();
+      sp->parent = n.parent() ? n.parent()->id() : SID::INVALID;
+      sp->children.reserve(n.children().size());
+      for (const auto &c: n.children()) sp->children.push_back(c->id());
+      sp->data = n.data;
+      sp->version = n.version;
+      sp->enveloppe = captureEnveloppe(n, old);
+      s->_species.emplace_hint(s->_species.end(), n.id(), std::move(sp));
+    }
+
+    return s;
+  }
+
+private:
+  uint _epoch;          ///< Step at which this snapshot was taken
+  SID _root;            ///< Identificator of the primordial species
+  Collection _species;  ///< Frozen species
+  LivingSet _alive;     ///< Species alive at that time
+
+  /// \returns a frozen copy of \p n's enveloppe, reusing the previous one
+  /// (or parts of it) from \p old when possible
+  template <typename NODE>
+  static std::shared_ptr<const Enveloppe>
+  captureEnveloppe (const NODE &n, const Species *old) {
+    const uint k = n.rset->size();
+
+    if (old) {
+      const auto &oe = *old->enveloppe;
+      bool same = (oe.rset.size() == k);
+      for (uint i=0; i<k && same; i++)
+        same = (old->representativeId(i) == n.representativeId(i));
+      if (same) return old->enveloppe;
+    }
+
+    auto e = std::make_shared<Enveloppe>();
+    e->rset.reserve(k);
+    for (uint i=0; i<k; i++) {
+      GID gid = n.representativeId(i);
+
+      Representative_ptr r = nullptr;
+      if (old)
+        for (uint j=0; j<old->enveloppe->rset.size() && !r; j++)
+          if (old->representativeId(j) == gid)
+            r = old->enveloppe->rset[j];
+
+      if (!r)
+        r = std::make_shared<Representative>(
+              Representative{(*n.rset)[i].timestamp, (*n.rset)[i].genome});
+
+      e->rset.push_back(r);
+    }
+    e->distances = *n.distances;
+
+    return e;
+  }
+};
+
+} // end of namespace phylogeny
+
+#endif // KGD_APOGET_SNAPSHOT_HPP
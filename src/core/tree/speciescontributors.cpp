@@ -64,7 +64,7 @@ SID Contributors::update (Contributions ctbs,
   return currentMain();
 }
 
-SID Contributors::currentMain (void) {
+SID Contributors::currentMain (void) const {
   assert(nodeID != SID::INVALID);
 
   if (vec.empty())
@@ -82,9 +82,13 @@ SID Contributors::currentMain (void) {
   return mc.elligible() ? mc.speciesID() : SID::INVALID;
 }
 
-SID Contributors::updateElligibilities(const ValidityEvaluator &elligible) {
-  for (Contributor &c: vec)
-    c.setElligible(elligible(nodeID, c.speciesID()));
+SID Contributors::updateElligibilities(const ValidityEvaluator &elligible,
+                                       bool *changed) {
+  for (Contributor &c: vec) {
+    bool e = elligible(nodeID, c.speciesID());
+    if (changed && e != c.elligible())  *changed = true;
+    c.setElligible(e);
+  }
 
   return currentMain();
 }
@@ -151,13 +151,15 @@ public:
   SID update (Contributions ctbs, const ValidityEvaluator &elligible);
 
   /// \return the id of the node's main contributor or SID::INVALID if none is found
-  SID currentMain (void);
+  SID currentMain (void) const;
 
   /// Updates, for each contributions, whether it is coming from a valid
   /// candidate to being a major contributor or not
   ///
-  /// \return the updated parent
-  SID updateElligibilities (const ValidityEvaluator &elligible);
+  /// \return the updated parent. \p changed, if provided, is set when any
+  /// elligibility was modified
+  SID updateElligibilities (const ValidityEvaluator &elligible,
+                            bool *changed = nullptr);
 
   /// Allow const iteration of the underlying container
   const auto begin (void) const {
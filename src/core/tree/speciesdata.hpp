@@ -29,6 +29,15 @@ struct SpeciesData {
   /// Number of registered future candidate for insertion in this species
   uint pendingCandidates;
 
+  /// \returns whether \p lhs and \p rhs hold the same values
+  friend bool operator== (const SpeciesData &lhs, const SpeciesData &rhs) {
+    return lhs.firstAppearance == rhs.firstAppearance
+        && lhs.lastAppearance == rhs.lastAppearance
+        && lhs.count == rhs.count
+        && lhs.currentlyAlive == rhs.currentlyAlive
+        && lhs.pendingCandidates == rhs.pendingCandidates;
+  }
+
   /// Serialize to json
   friend void to_json (json &j, const SpeciesData &d) {
     j = {d.firstAppearance, d.lastAppearance,
@@ -0,0 +1,52 @@
+#include "../ptreeconfig.h"
+
+#include "threadpool.h"
+
+namespace phylogeny {
+
+ThreadPool::ThreadPool (uint threads) : _stop(false) {
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  if (threads <= 1) return;
+
+  _workers.reserve(threads);
+  for (uint i=0; i<threads; i++)
+    _workers.emplace_back(&ThreadPool::work, this);
+}
+
+ThreadPool::~ThreadPool (void) {
+  {
+    std::unique_lock lock (_mutex);
+    _stop = true;
+  }
+  _cv.notify_all();
+  for (std::thread &t: _workers)  t.join();
+}
+
+ThreadPool& ThreadPool::global (void) {
+  static ThreadPool pool (config::PTree::serializationThreads());
+  return pool;
+}
+
+void ThreadPool::push (std::function<void()> &&task) {
+  {
+    std::unique_lock lock (_mutex);
+    _tasks.push_back(std::move(task));
+  }
+  _cv.notify_one();
+}
+
+void ThreadPool::work (void) {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock lock (_mutex);
+      _cv.wait(lock, [this] { return _stop || !_tasks.empty(); });
+      if (_tasks.empty()) return;  // Stopping with nothing left to do
+      task = std::move(_tasks.front());
+      _tasks.pop_front();
+    }
+    task();
+  }
+}
+
+} // end of namespace phylogeny
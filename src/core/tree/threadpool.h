@@ -0,0 +1,109 @@
+#ifndef KGD_APOGET_THREADPOOL_H
+#define KGD_APOGET_THREADPOOL_H
+
+/*!
+ * \file threadpool.h
+ *
+ * Contains the definition of the fixed-size thread pool used to (de)serialize
+ * trees in parallel
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "treetypes.h"
+
+namespace phylogeny {
+
+/// Fixed-size pool of worker threads consuming a FIFO of tasks.
+///
+/// Tasks must not wait on other tasks of the same pool (workers would
+/// deadlock once all of them are waiting).
+class ThreadPool {
+public:
+  /// Creates a pool of \p threads workers (0 for the number of hardware
+  /// threads). A single-threaded pool runs everything in the caller's thread
+  explicit ThreadPool (uint threads = 0);
+
+  /// Waits for queued tasks and stops the workers
+  ~ThreadPool (void);
+
+  /// Pools own threads
+  ThreadPool (const ThreadPool&) = delete;
+
+  /// Pools own threads
+  ThreadPool& operator= (const ThreadPool&) = delete;
+
+  /// \returns the shared pool, sized by config::PTree::serializationThreads on
+  /// first use
+  static ThreadPool& global (void);
+
+  /// \returns the number of tasks that may run concurrently
+  uint size (void) const {
+    return std::max<uint>(1, _workers.size());
+  }
+
+  /// Queues \p f for execution
+  /// \returns a future on its result (or exception)
+  template <typename F>
+  auto submit (F &&f) {
+    using R = std::invoke_result_t<F>;
+    auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+    std::future<R> future = task->get_future();
+    if (_workers.empty())
+      (*task)();
+    else
+      push([task] { (*task)(); });
+    return future;
+  }
+
+  /// Calls \p f(begin, end) over contiguous ranges covering [0,n[, each of at
+  /// least \p grain items (but the last), and waits for all of them.
+  /// Ranges are processed in parallel but \p f is expected to write its
+  /// results at the given indices, so that the outcome does not depend on
+  /// scheduling. Rethrows the exception of the first failing range (if any)
+  template <typename F>
+  void parallelFor (size_t n, size_t grain, F f) {
+    size_t chunks = std::min<size_t>(n / std::max<size_t>(1, grain),
+                                     4 * size());
+    if (chunks <= 1) {
+      if (n > 0) f(size_t(0), n);
+      return;
+    }
+
+    std::vector<std::future<void>> futures;
+    futures.reserve(chunks);
+    for (size_t i=0; i<chunks; i++) {
+      size_t begin = n * i / chunks, end = n * (i+1) / chunks;
+      futures.push_back(submit([&f, begin, end] { f(begin, end); }));
+    }
+
+    // Wait for everyone before rethrowing (ranges reference the caller's data)
+    for (auto &future: futures) future.wait();
+    for (auto &future: futures) future.get();
+  }
+
+private:
+  std::vector<std::thread> _workers;  ///< Worker threads (none if sequential)
+
+  std::mutex _mutex;  ///< Protects the queue
+  std::condition_variable _cv;  ///< Signals new tasks or _stop
+  std::deque<std::function<void()>> _tasks;  ///< Queued tasks
+  bool _stop;  ///< Whether the workers should terminate
+
+  /// Appends \p task to the queue
+  void push (std::function<void()> &&task);
+
+  /// Worker main loop
+  void work (void);
+};
+
+} // end of namespace phylogeny
+
+#endif // KGD_APOGET_THREADPOOL_H
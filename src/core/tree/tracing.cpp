@@ -0,0 +1,154 @@
+#include <array>
+#include <fstream>
+#include <iomanip>
+
+#include "tracing.h"
+
+namespace phylogeny {
+namespace tracing {
+
+std::atomic<bool> active {false};
+
+namespace {
+
+/// Number of events per allocation
+static constexpr size_t BLOCK_SIZE = 4096;
+
+/// Fixed-size chunk of a thread's events. Only the owning thread writes,
+/// readers only access the first (acquired) count events
+struct Block {
+  std::array<Event, BLOCK_SIZE> events;  ///< Storage
+  std::atomic<size_t> count {0};         ///< Number of published events
+  std::atomic<Block*> next {nullptr};    ///< Following block, if any
+};
+
+/// Events of a single thread, as a list of blocks
+struct Buffer {
+  uint tid;                 ///< Track identifier
+  Block *head;              ///< First block (never null)
+  Block *tail;              ///< Block currently filled (owner only)
+  Buffer *next = nullptr;   ///< Next buffer in the registry
+
+  /// Creates a buffer for track \p tid
+  explicit Buffer (uint tid) : tid(tid), head(new Block), tail(head) {}
+
+  /// Frees all blocks but the first and empties it
+  void clear (void) {
+    Block *b = head->next.exchange(nullptr);
+    while (b) {
+      Block *n = b->next.load();
+      delete b;
+      b = n;
+    }
+    head->count = 0;
+    tail = head;
+  }
+};
+
+/// Registry of all threads buffers (push-front only, buffers are never freed
+/// so that spans outlive their threads)
+std::atomic<Buffer*> buffers {nullptr};
+
+/// Source of track identifiers
+std::atomic<uint> nextTID {0};
+
+/// \returns the calling thread's buffer (registered on first use)
+Buffer& local (void) {
+  thread_local Buffer *buffer = [] {
+    Buffer *b = new Buffer (nextTID++);
+    b->next = buffers.load(std::memory_order_relaxed);
+    while (!buffers.compare_exchange_weak(b->next, b,
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+    return b;
+  }();
+  return *buffer;
+}
+
+/// Calls \p f on every published event of every buffer
+template <typename F>
+void forEach (F f) {
+  for (Buffer *b = buffers.load(std::memory_order_acquire); b; b = b->next)
+    for (Block *k = b->head; k; k = k->next.load(std::memory_order_acquire)) {
+      size_t n = k->count.load(std::memory_order_acquire);
+      for (size_t i=0; i<n; i++)  f(*b, k->events[i]);
+    }
+}
+
+} // end of anonymous namespace
+
+void start (void) {
+  now();  // Ensures the epoch is set
+  active = true;
+}
+
+void stop (void) {
+  active = false;
+}
+
+void clear (void) {
+  for (Buffer *b = buffers.load(); b; b = b->next)  b->clear();
+}
+
+uint64_t now (void) {
+  using Clock = std::chrono::steady_clock;
+  static const Clock::time_point epoch = Clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           Clock::now() - epoch).count();
+}
+
+void record (const Event &e) {
+  Buffer &b = local();
+  Block *k = b.tail;
+  size_t n = k->count.load(std::memory_order_relaxed);
+  if (n == BLOCK_SIZE) {
+    Block *nk = new Block;
+    k->next.store(nk, std::memory_order_release);
+    b.tail = k = nk;
+    n = 0;
+  }
+  k->events[n] = e;
+  k->count.store(n+1, std::memory_order_release);
+}
+
+size_t size (void) {
+  size_t n = 0;
+  forEach([&n] (const Buffer&, const Event&) { n++; });
+  return n;
+}
+
+bool writeTo (const std::string &filename) {
+  std::ofstream ofs (filename);
+  if (!ofs) return false;
+
+  ofs << std::fixed << std::setprecision(3)
+      << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+  bool first = true;
+  auto separator = [&ofs, &first] {
+    if (!first) ofs << ",";
+    ofs << "\n";
+    first = false;
+  };
+
+  for (Buffer *b = buffers.load(std::memory_order_acquire); b; b = b->next) {
+    separator();
+    ofs << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << b->tid
+        << ",\"args\":{\"name\":\"thread " << b->tid << "\"}}";
+  }
+
+  forEach([&] (const Buffer &b, const Event &e) {
+    separator();
+    ofs << "{\"name\":\"" << e.name << "\",\"cat\":\"apt\",\"ph\":\"X\""
+        << ",\"pid\":0,\"tid\":" << b.tid
+        << ",\"ts\":" << e.start * 1e-3 << ",\"dur\":" << e.duration * 1e-3;
+    if (e.arg >= 0) ofs << ",\"args\":{\"id\":" << e.arg << "}";
+    ofs << "}";
+  });
+
+  ofs << "\n]}\n";
+  return bool(ofs);
+}
+
+} // end of namespace tracing
+} // end of namespace phylogeny
@@ -0,0 +1,111 @@
+#ifndef KGD_APOGET_TRACING_H
+#define KGD_APOGET_TRACING_H
+
+/*!
+ * \file tracing.h
+ *
+ * Contains the definition of the (optional) span recorder exporting the tree
+ * operations as Chrome/Perfetto trace events.
+ *
+ * Spans are only compiled in when WITH_TRACING is defined (see the cmake
+ * option of the same name) and only recorded between tracing::start() and
+ * tracing::stop(). Otherwise APT_TRACE* expand to nothing.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "treetypes.h"
+
+namespace phylogeny {
+namespace tracing {
+
+/// A completed span
+struct Event {
+  const char *name;   ///< What was done (must have static storage duration)
+  uint64_t start;     ///< When it started (ns since the tracing epoch)
+  uint64_t duration;  ///< How long it lasted (ns)
+  int64_t arg;        ///< Optional identifier (species, genome, ...), -1 if none
+};
+
+/// Whether spans are currently recorded
+extern std::atomic<bool> active;
+
+/// \returns whether spans are currently recorded
+inline bool enabled (void) {
+  return active.load(std::memory_order_relaxed);
+}
+
+/// Starts recording spans (previous ones are kept, see clear())
+void start (void);
+
+/// Stops recording spans
+void stop (void);
+
+/// Discards all recorded spans.
+/// \warning No thread may be recording while this is called
+void clear (void);
+
+/// \returns nanoseconds elapsed since the tracing epoch
+uint64_t now (void);
+
+/// Appends \p e to the calling thread's buffer (wait-free, except for the
+/// occasional block allocation)
+void record (const Event &e);
+
+/// \returns the number of recorded spans
+size_t size (void);
+
+/// Writes all recorded spans, as Chrome trace-event json (complete "X"
+/// events, one track per thread), to \p filename.
+/// Spans still being recorded concurrently may or may not be included
+/// \returns whether the file was successfully written
+bool writeTo (const std::string &filename);
+
+/// Records the lifetime of an instance as a span (if tracing is enabled)
+class Span {
+  const char *_name;  ///< Span name
+  int64_t _arg;       ///< Span argument
+  uint64_t _start;    ///< Start time (or -1 if not recording)
+
+public:
+  /// Opens span \p name with optional argument \p arg
+  explicit Span (const char *name, int64_t arg = -1)
+    : _name(name), _arg(arg), _start(enabled() ? now() : uint64_t(-1)) {}
+
+  /// Closes the span
+  ~Span (void) {
+    if (_start != uint64_t(-1))
+      record({_name, _start, now() - _start, _arg});
+  }
+};
+
+} // end of namespace tracing
+} // end of namespace phylogeny
+
+#ifdef WITH_TRACING
+/// Concatenation helpers for unique variable names
+#define APT_TRACE_CAT_(A, B) A##B
+#define APT_TRACE_CAT(A, B) APT_TRACE_CAT_(A, B)
+
+/// Records the rest of the enclosing scope as span \p NAME
+#define APT_TRACE(NAME) \
+  phylogeny::tracing::Span APT_TRACE_CAT(_aptSpan, __LINE__) (NAME)
+
+/// Records the rest of the enclosing scope as span \p NAME with argument
+/// \p ARG (e.g. a species or genome identifier)
+#define APT_TRACE_ARG(NAME, ARG) \
+  phylogeny::tracing::Span APT_TRACE_CAT(_aptSpan, __LINE__) (NAME, \
+                                                              int64_t(ARG))
+#else
+/// Records the rest of the enclosing scope as span \p NAME (disabled)
+#define APT_TRACE(NAME)
+
+/// Records the rest of the enclosing scope as span \p NAME with argument
+/// \p ARG (disabled)
+#define APT_TRACE_ARG(NAME, ARG)
+#endif
+
+#endif // KGD_APOGET_TRACING_H
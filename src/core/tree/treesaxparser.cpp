@@ -0,0 +1,102 @@
+#include "treesaxparser.h"
+
+namespace phylogeny {
+
+json* TreeSaxParser::insert (json &&v) {
+  if (!buildingValue()) {
+    _value = std::move(v);
+    return &_value;
+  }
+
+  json &parent = *_values.back();
+  if (parent.is_array()) {
+    parent.push_back(std::move(v));
+    return &parent.back();
+
+  } else {
+    json &field = parent[_valueKey];
+    field = std::move(v);
+    return &field;
+  }
+}
+
+void TreeSaxParser::deliver (void) {
+  Frame &f = _frames.back();
+  if (f.context == Context::TOP)
+    _header[f.key] = std::move(_value);
+  else
+    f.fields[f.key] = std::move(_value);
+  _value = json();
+}
+
+bool TreeSaxParser::value (json &&v) {
+  insert(std::move(v));
+  if (!buildingValue()) deliver();
+  return true;
+}
+
+bool TreeSaxParser::start_object (std::size_t) {
+  if (buildingValue())
+    _values.push_back(insert(json::object()));
+
+  else if (_frames.empty())
+    _frames.push_back({Context::TOP, "", json::object()});
+
+  else if (_frames.back().context == Context::CHILDREN
+           || (_frames.back().context == Context::TOP
+               && _frames.back().key == "tree")) {
+    _frames.push_back({Context::NODE, "", json::object()});
+    _depth++;
+
+  } else
+    _values.push_back(insert(json::object()));
+
+  return true;
+}
+
+bool TreeSaxParser::key (json::string_t &k) {
+  if (buildingValue())
+    _valueKey = k;
+  else
+    _frames.back().key = k;
+  return true;
+}
+
+bool TreeSaxParser::end_object (void) {
+  if (buildingValue()) {
+    _values.pop_back();
+    if (!buildingValue()) deliver();
+
+  } else {
+    Frame f = std::move(_frames.back());
+    _frames.pop_back();
+    if (f.context == Context::NODE) _onNode(std::move(f.fields), --_depth);
+  }
+
+  return true;
+}
+
+bool TreeSaxParser::start_array (std::size_t) {
+  if (!buildingValue() && !_frames.empty()
+      && _frames.back().context == Context::NODE
+      && _frames.back().key == "children")
+    _frames.push_back({Context::CHILDREN, "", json()});
+
+  else
+    _values.push_back(insert(json::array()));
+
+  return true;
+}
+
+bool TreeSaxParser::end_array (void) {
+  if (buildingValue()) {
+    _values.pop_back();
+    if (!buildingValue()) deliver();
+
+  } else
+    _frames.pop_back();
+
+  return true;
+}
+
+} // end of namespace phylogeny
@@ -0,0 +1,116 @@
+#ifndef KGD_APOGET_TREE_SAX_PARSER_H
+#define KGD_APOGET_TREE_SAX_PARSER_H
+
+/*!
+ * \file treesaxparser.h
+ *
+ * Contains the definition of a streaming parser for json phylogenetic trees
+ */
+
+#include <functional>
+
+#include "treetypes.h"
+
+namespace phylogeny {
+
+/// SAX handler for the json layout produced by PhylogeneticTree::toJson.
+///
+/// Species are handed over, one at a time, as soon as they are complete
+/// (without their "children" field) so that only the species being parsed
+/// is ever held as a json value. As keys are sorted, children are always
+/// complete before their parent (i.e. species come in post-order) and are
+/// delivered along with their depth in the hierarchy. Top-level fields (except the hierarchy) are
+/// collected in header().
+///
+/// \see nlohmann::json::sax_parse
+class TreeSaxParser {
+public:
+  /// Function called with each completed species and its depth (0 for the
+  /// primordial species)
+  using NodeCallback = std::function<void(json&&, uint)>;
+
+  /// Creates a parser handing species over to \p onNode
+  TreeSaxParser (NodeCallback onNode) : _onNode(onNode), _depth(0) {}
+
+  /// \returns the top-level fields (all but the hierarchy)
+  const json& header (void) const {
+    return _header;
+  }
+
+  /// \name SAX interface
+  ///@{
+
+  bool null (void) {  return value(nullptr);  }  ///< Null value
+  bool boolean (bool v) {  return value(v);  }   ///< Boolean value
+  bool number_integer (json::number_integer_t v) {  return value(v);  } ///< Signed value
+  bool number_unsigned (json::number_unsigned_t v) {  return value(v);  } ///< Unsigned value
+  bool number_float (json::number_float_t v, const json::string_t&) {  return value(v);  } ///< Floating point value
+  bool string (json::string_t &v) {  return value(v);  } ///< String value
+
+  /// Binary values are not part of the tree layout
+  template <typename B>
+  bool binary (B&) {
+    utils::doThrow<std::invalid_argument>("Unexpected binary value in tree");
+    return false;
+  }
+
+  bool start_object (std::size_t);  ///< Object start
+  bool key (json::string_t &k);     ///< Object key
+  bool end_object (void);           ///< Object end
+  bool start_array (std::size_t);   ///< Array start
+  bool end_array (void);            ///< Array end
+
+  /// Reports errors as std::invalid_argument
+  template <typename E>
+  bool parse_error (std::size_t position, const std::string&, const E &e) {
+    utils::doThrow<std::invalid_argument>("Failed to parse tree at byte ",
+                                          position, ": ", e.what());
+    return false;
+  }
+
+  ///@}
+
+private:
+  /// Structural element being parsed
+  enum class Context {
+    TOP,      ///< Top-level object
+    NODE,     ///< Species object
+    CHILDREN  ///< Species' children array
+  };
+
+  /// Parsing state for a structural element
+  struct Frame {
+    Context context;  ///< Type of element
+    std::string key;  ///< Last key read (objects only)
+    json fields;      ///< Fields read so far (objects only)
+  };
+
+  NodeCallback _onNode;  ///< Function receiving completed species
+  json _header;          ///< Top-level fields
+
+  std::vector<Frame> _frames;  ///< Structural elements being parsed
+  uint _depth;  ///< Number of species being parsed
+
+  json _value;  ///< Field value being built
+  std::vector<json*> _values;  ///< Containers being built inside _value
+  std::string _valueKey;  ///< Last key read inside _value
+
+  /// \returns whether a field value is currently being built
+  bool buildingValue (void) const {
+    return !_values.empty();
+  }
+
+  /// Inserts \p v at the current position in the field value being built
+  /// \returns a pointer to the inserted value
+  json* insert (json &&v);
+
+  /// Stores the completed field value in the current structural element
+  void deliver (void);
+
+  /// Handles a scalar value
+  bool value (json &&v);
+};
+
+} // end of namespace phylogeny
+
+#endif // KGD_APOGET_TREE_SAX_PARSER_H
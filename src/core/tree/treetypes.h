@@ -10,6 +10,13 @@
 
 #include <type_traits>
 #include <set>
+#include <algorithm>
+#include <iterator>
+#include <shared_mutex>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <functional>
 
 #include "kgd/external/json.hpp"
 #include "kgd/utils/utils.h"
@@ -81,6 +88,33 @@ std::ostream& operator<< (std::ostream &os, SID sid);
 /// Collections of still-alive species identificators
 using LivingSet = std::set<SID>;
 
+/// Changes in the set of still-alive species between two consecutive steps
+struct LivingDelta {
+  /// Species alive at the current step but not at the previous one
+  std::vector<SID> appeared;
+
+  /// Species alive at the previous step but not at the current one
+  std::vector<SID> disappeared;
+
+  /// \returns whether the living set is unchanged
+  bool empty (void) const {
+    return appeared.empty() && disappeared.empty();
+  }
+
+  /// Computes the differences between \p previous and \p current
+  static LivingDelta between (const LivingSet &previous,
+                              const LivingSet &current) {
+    LivingDelta d;
+    std::set_difference(current.begin(), current.end(),
+                        previous.begin(), previous.end(),
+                        std::back_inserter(d.appeared));
+    std::set_difference(previous.begin(), previous.end(),
+                        current.begin(), current.end(),
+                        std::back_inserter(d.disappeared));
+    return d;
+  }
+};
+
 /// Holds the identificators for a given individual
 struct PID {
   GID gid; ///< Identificator in the genomic population
@@ -187,6 +221,13 @@ struct Genealogy {
   }
 };
 
+/// How the enveloppes of a tree are decoded on load
+enum class LoadMode {
+  EAGER,  ///< Everything is decoded while loading
+  LAZY    ///< Genomes keep their serialized form until first accessed (user
+          ///  data is always decoded)
+};
+
 /// Contains the result from an insertion into the tree
 template <typename UserData>
 struct InsertionResult {
@@ -196,6 +237,138 @@ struct InsertionResult {
 
 namespace _details {
 
+/// Shared mutex that can be turned into a no-op when thread-safety is not
+/// required (the default)
+class OptionalMutex {
+  std::shared_mutex _mutex;  ///< The actual mutex
+  bool _enabled = false;  ///< Whether locking is performed at all
+
+public:
+  /// Sets whether this mutex should actually lock
+  void setEnabled (bool e) {  _enabled = e;  }
+
+  /// \returns whether this mutex actually locks
+  bool enabled (void) const {  return _enabled;  }
+
+  /// Acquires exclusive ownership (if enabled)
+  void lock (void) {  if (_enabled) _mutex.lock();  }
+
+  /// Releases exclusive ownership (if enabled)
+  void unlock (void) {  if (_enabled) _mutex.unlock();  }
+
+  /// Acquires shared ownership (if enabled)
+  void lock_shared (void) {  if (_enabled) _mutex.lock_shared();  }
+
+  /// Releases shared ownership (if enabled)
+  void unlock_shared (void) {  if (_enabled) _mutex.unlock_shared();  }
+};
+
+/// Pointer-like wrapper sharing its (heap-allocated) value between copies
+/// until one of them requests write access through mut()
+///
+/// The value can also be deferred (see deferred()), i.e. only produced on
+/// first access. Concurrent readers are then safe: the value is produced once
+/// and shared by all copies.
+template <typename T>
+class CopyOnWrite {
+  /// Value produced on first access
+  struct Deferred {
+    std::function<T()> make;  ///< Producer (released once used)
+    size_t size;              ///< Size of the value to come
+    std::once_flag once;      ///< Guards the production
+    std::shared_ptr<T> value; ///< The value, once produced
+  };
+
+  std::shared_ptr<T> _ptr;  ///< The (possibly shared) value
+  std::shared_ptr<Deferred> _deferred;  ///< The pending value, if any
+
+  /// Creates a deferred value
+  explicit CopyOnWrite (std::shared_ptr<Deferred> &&d)
+    : _deferred(std::move(d)) {}
+
+  /// \returns the value, producing it first if needed
+  const T& get (void) const {
+    if (!_deferred) return *_ptr;
+
+    Deferred &d = *_deferred;
+    std::call_once(d.once, [&d] {
+      d.value = std::make_shared<T>(d.make());
+      d.make = nullptr;
+    });
+    return *d.value;
+  }
+
+public:
+  /// Creates a default-constructed value
+  CopyOnWrite (void) : _ptr(std::make_shared<T>()) {}
+
+  /// \returns a wrapper whose value is only produced by \p make on first
+  /// access. \p size is the size (e.g. number of elements) of that value,
+  /// available beforehand through size()
+  static CopyOnWrite deferred (std::function<T()> make, size_t size) {
+    auto d = std::make_shared<Deferred>();
+    d->make = std::move(make);
+    d->size = size;
+    return CopyOnWrite(std::move(d));
+  }
+
+  /// Replaces the current value with \p v (without touching other copies)
+  CopyOnWrite& operator= (T v) {
+    _ptr = std::make_shared<T>(std::move(v));
+    _deferred.reset();
+    return *this;
+  }
+
+  /// \returns a read-only reference to the value
+  const T& operator* (void) const {  return get();  }
+
+  /// \returns a read-only pointer to the value
+  const T* operator-> (void) const {  return &get();  }
+
+  /// \returns the value if it exists (i.e. is not still deferred), without
+  /// producing it. nullptr otherwise
+  const T* peek (void) const {
+    if (!_deferred) return _ptr.get();
+    return _deferred->value.get();
+  }
+
+  /// \returns the size of the value, without producing it if deferred
+  size_t size (void) const {
+    return _deferred ? _deferred->size : _ptr->size();
+  }
+
+  /// \returns whether the value is currently shared with other copies
+  bool shared (void) const {
+    return _deferred ? _deferred.use_count() > 1 : _ptr.use_count() > 1;
+  }
+
+  /// \returns a writable reference to the value, detaching it from other
+  /// copies first if needed
+  T& mut (void) {
+    if (_deferred) {
+      const T &v = get();
+      if (_deferred.use_count() > 1)
+        _ptr = std::make_shared<T>(v);
+      else
+        _ptr = std::move(_deferred->value);
+      _deferred.reset();
+
+    } else if (shared())
+      _ptr = std::make_shared<T>(*_ptr);
+    else  // Synchronize with the release of the last other owner
+      std::atomic_thread_fence(std::memory_order_acquire);
+    return *_ptr;
+  }
+
+  /// Asserts that two values are equal. Shared values trivially are
+  friend void assertEqual (const CopyOnWrite &lhs, const CopyOnWrite &rhs,
+                           bool deepcopy) {
+    using utils::assertEqual;
+    if (lhs._ptr != rhs._ptr || lhs._deferred != rhs._deferred)
+      assertEqual(*lhs, *rhs, deepcopy);
+  }
+};
+
 /// Distance & compatibilities cache
 struct DCCache {
   /// Cache collection of distances
@@ -272,6 +445,34 @@ EnveloppeContribution computeContribution(const DistanceMap &edist,
                                           const std::vector<float> &gdist,
                                           GID gid, const std::vector<GID> &ids);
 
+/// \name Enveloppe criteria
+/// Individual criteria behind computeContribution (selected by
+/// Config::DEBUG_ENV_CRIT, in this order)
+///@{
+
+/// Maximize average (has a known pitfall)
+EnveloppeContribution maxAverage(const DistanceMap &edist,
+                                 const std::vector<float> &gdist,
+                                 GID gid, const std::vector<GID> &ids);
+
+/// Just maximize min distance
+EnveloppeContribution maxMinDist(const DistanceMap &edist,
+                                 const std::vector<float> &gdist,
+                                 GID gid, const std::vector<GID> &ids);
+
+/// Maximize mean distance while reducing deviation
+EnveloppeContribution maxAvgMinStdDev(const DistanceMap &edist,
+                                      const std::vector<float> &gdist,
+                                      GID gid, const std::vector<GID> &ids);
+
+/// Weighted by distance to mean
+EnveloppeContribution maxWeightedDist2Avg(const DistanceMap &edist,
+                                          const std::vector<float> &gdist,
+                                          GID gid,
+                                          const std::vector<GID> &ids);
+
+///@}
+
 } // end of namespace _details
 
 } // end of namespace phylogeny
@@ -0,0 +1,17 @@
+#include "driver.h"
+
+namespace synthetic {
+
+void to_json (nlohmann::json &j, const Parameters &p) {
+  j = {
+    { "population", p.population },
+    { "litter", p.litter },
+    { "generations", p.generations },
+    { "mutationRate", p.mutationRate },
+    { "mutationStrength", p.mutationStrength },
+    { "matingAttempts", p.matingAttempts },
+    { "seed", p.seed }
+  };
+}
+
+} // end of namespace synthetic
@@ -0,0 +1,251 @@
+#ifndef KGD_APOGET_SYNTHETIC_DRIVER_H
+#define KGD_APOGET_SYNTHETIC_DRIVER_H
+
+/*!
+ * \file driver.h
+ *
+ * Contains the definition of a synthetic population driver feeding a
+ * phylogenetic tree the same way a real simulation would
+ */
+
+#include "../core/tree/concurrenttree.hpp"
+#include "genome.h"
+
+namespace synthetic {
+
+/// Default tree type fed by the driver. Its callbacks are left to the
+/// executables (see phylogeny::Callbacks_t), which may also feed trees of their
+/// own (e.g. with user data) through BasicDriver
+using Tree = phylogeny::PhylogeneticTree<Genome, phylogeny::NoUserData>;
+
+/// The concurrent version of Tree (sharing the same callbacks)
+using ConcurrentTree =
+  phylogeny::ConcurrentPhylogeneticTree<Genome, phylogeny::NoUserData>;
+
+/// Parameters of a synthetic evolution
+struct Parameters {
+  uint population = 100;        ///< Number of individuals per generation
+  uint litter = 2;              ///< Number of offsprings per successful mating
+  uint generations = 100;       ///< Number of generations for run()
+  float mutationRate = .5;      ///< Per-trait mutation probability
+  float mutationStrength = .1;  ///< Standard deviation of a trait mutation
+  uint matingAttempts = 10;     ///< Maximal mating attempts per individual
+  uint seed = 0;                ///< Random number generator seed
+
+  /// Serializes the parameters into a json
+  friend void to_json (nlohmann::json &j, const Parameters &p);
+};
+
+/// Drives a population of synthetic genomes through non-overlapping
+/// generations and reports every birth, death and step to a tree
+///
+/// Each generation:
+///   - random females and males are paired through genotype::bailOutCrossver
+///   until enough offsprings are conceived (registerCandidate)
+///   - surplus offsprings are stillborn (unregisterCandidate)
+///   - the others are born (addGenome)
+///   - parents are replaced, with a random subset surviving if too few
+///   offsprings were conceived (delGenome for the others)
+///   - the tree is notified of the living population (step)
+///
+/// Fully deterministic for a given seed
+///
+/// \tparam TREE the tree type to feed, of synthetic genomes (e.g. Tree or
+/// ConcurrentTree, whose thread-safe insertion API is then used)
+template <typename TREE>
+class BasicDriver {
+public:
+  /// The tree type this driver feeds
+  using Tree = TREE;
+
+  /// Helper alias to the source of randomness
+  using Dice = rng::FastDice;
+
+  /// Counters of the reproductive dynamics
+  struct Stats {
+    size_t matings = 0;       ///< Number of mating attempts
+    size_t bailouts = 0;      ///< Number of incompatible matings
+    size_t births = 0;        ///< Number of offsprings inserted in the tree
+    size_t stillborns = 0;    ///< Number of offsprings cancelled
+    size_t deaths = 0;        ///< Number of individuals removed from the tree
+  };
+
+  /// Creates a driver feeding \p tree and inserts the primordial population
+  BasicDriver (Tree &tree, const Parameters &params);
+
+  /// Runs a single generation
+  void step (void) {
+    step([] (auto &&insert) { insert(); });
+  }
+
+  /// Runs a single generation with every insertion (a nullary functor calling
+  /// addGenome) forwarded to \p wrap, e.g. to time them
+  template <typename F>
+  void step (F &&wrap) {
+    step(wrap, [] (auto &&stepTree) { stepTree(); });
+  }
+
+  /// Runs a single generation with every insertion forwarded to
+  /// \p wrapInsertion and the final call to PhylogeneticTree::step (which may
+  /// perform stillborn trimming) forwarded to \p wrapStep
+  template <typename F, typename G>
+  void step (F &&wrapInsertion, G &&wrapStep) {
+    stepBatch([&wrapInsertion] (size_t n, const auto &insert) {
+      for (size_t i=0; i<n; i++)  wrapInsertion([&insert, i] { insert(i); });
+    }, wrapStep);
+  }
+
+  /// Runs a single generation with the insertion of all \c n offsprings
+  /// delegated to \p insertAll(n, insert), which must call insert(i) exactly
+  /// once for each i in [0,n[. With a ConcurrentTree, these calls can be
+  /// spread over multiple threads. The final call to PhylogeneticTree::step is
+  /// forwarded to \p wrapStep
+  template <typename B, typename G>
+  void stepBatch (B &&insertAll, G &&wrapStep) {
+    std::vector<Genome> offspring = conceive();
+    insertAll(offspring.size(), [this, &offspring] (size_t i) {
+      Genome &g = offspring[i];
+      g.gen.setSID(_tree.addGenome(g).sid);
+    });
+    replace(offspring);
+    wrapStep([this] {
+      _tree.step(_step, _population.begin(), _population.end(),
+                 [] (const Genome &g) { return g.gen.self.sid; });
+    });
+  }
+
+  /// Runs the configured number of generations, calling \p onStep(step) after
+  /// each
+  template <typename F>
+  void run (F &&onStep) {
+    for (uint i=0; i<_params.generations; i++) {
+      step();
+      onStep(_step);
+    }
+  }
+
+  /// \returns the underlying tree
+  const Tree& tree (void) const { return _tree;        }
+
+  /// \returns the parameters of this evolution
+  const Parameters& parameters (void) const { return _params;  }
+
+  /// \returns the current (living) population
+  const std::vector<Genome>& population (void) const {  return _population; }
+
+  /// \returns the number of generations run so far
+  uint currentStep (void) const { return _step;        }
+
+  /// \returns the reproductive dynamics counters
+  const Stats& stats (void) const { return _stats;       }
+
+private:
+  Tree &_tree;            ///< The tree to feed
+  Parameters _params;     ///< The evolution parameters
+  Dice _dice;             ///< The source of randomness
+  phylogeny::GIDManager _gidManager;  ///< The genomes identificators source
+  std::vector<Genome> _population;    ///< The living genomes
+  uint _step;             ///< The current generation
+  Stats _stats;           ///< The reproductive dynamics counters
+
+  /// \returns the offsprings of the current population, all registered as
+  /// candidates in the tree
+  std::vector<Genome> conceive (void);
+
+  /// Replaces the current population with \p offspring (completed by
+  /// surviving parents)
+  void replace (std::vector<Genome> &offspring);
+};
+
+/// Driver of a sequential tree
+using Driver = BasicDriver<Tree>;
+
+/// Driver of a concurrent tree
+using ConcurrentDriver = BasicDriver<ConcurrentTree>;
+
+template <typename TREE>
+BasicDriver<TREE>::BasicDriver (Tree &tree, const Parameters &params)
+  : _tree(tree), _params(params), _dice(params.seed), _step(0) {
+
+  Genome::Mutations::rate = _params.mutationRate;
+  Genome::Mutations::strength = _params.mutationStrength;
+
+  _tree.setStep(_step);
+  _population.reserve(_params.population);
+  for (uint i=0; i<_params.population; i++) {
+    Genome g = Genome::primordial(_gidManager(), _dice);
+    g.gen.setSID(_tree.addGenome(g).sid);
+    _population.push_back(g);
+    _stats.births++;
+  }
+  _tree.step(_step, _population.begin(), _population.end(),
+             [] (const Genome &g) { return g.gen.self.sid; });
+}
+
+template <typename TREE>
+std::vector<Genome> BasicDriver<TREE>::conceive (void) {
+  std::vector<uint> females, males;
+  for (uint i=0; i<_population.size(); i++)
+    (_population[i].sex() == genotype::BOCData::FEMALE ? females : males)
+      .push_back(i);
+
+  std::vector<Genome> offspring, litter (_params.litter);
+  if (females.empty() || males.empty())  return offspring;
+
+  std::uniform_int_distribution<uint> female (0, females.size()-1),
+                                      male (0, males.size()-1);
+
+  const size_t attempts = size_t(_params.matingAttempts) * _params.population;
+  for (size_t a=0; a<attempts && offspring.size() < _params.population; a++) {
+    const Genome &mother = _population[females[_dice(female)]],
+                 &father = _population[males[_dice(male)]];
+
+    _stats.matings++;
+    if (!genotype::bailOutCrossver(mother, father, litter, _dice)) {
+      _stats.bailouts++;
+      continue;
+    }
+
+    for (Genome &child: litter) {
+      child.gen.updateAfterCrossing(mother.gen, father.gen, _gidManager);
+      _tree.registerCandidate(child.gen);
+      offspring.push_back(child);
+    }
+  }
+
+  // Last litter may overflow
+  while (offspring.size() > _params.population) {
+    _tree.unregisterCandidate(offspring.back().gen);
+    offspring.pop_back();
+    _stats.stillborns++;
+  }
+
+  _tree.setStep(_step+1);
+  return offspring;
+}
+
+template <typename TREE>
+void BasicDriver<TREE>::replace (std::vector<Genome> &offspring) {
+  _stats.births += offspring.size();
+
+  // Not enough offsprings: a random subset of the parents survives
+  uint survivors = _params.population - std::min<size_t>(_params.population,
+                                                          offspring.size());
+  survivors = std::min<size_t>(survivors, _population.size());
+  for (uint i=0; i<survivors; i++) {
+    std::uniform_int_distribution<uint> pick (i, _population.size()-1);
+    std::swap(_population[i], _population[_dice(pick)]);
+  }
+
+  for (uint i=survivors; i<_population.size(); i++) {
+    _tree.delGenome(_population[i]);
+    _stats.deaths++;
+  }
+  _population.resize(survivors);
+  _population.insert(_population.end(), offspring.begin(), offspring.end());
+  _step++;
+}
+
+} // end of namespace synthetic
+
+#endif // KGD_APOGET_SYNTHETIC_DRIVER_H
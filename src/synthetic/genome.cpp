@@ -0,0 +1,63 @@
+#include "genome.h"
+
+namespace synthetic {
+
+float Genome::Mutations::rate = .5;
+float Genome::Mutations::strength = .1;
+
+Genome Genome::primordial (phylogeny::GID gid, Dice &dice) {
+  Genome g;
+  g.gen.self = phylogeny::PID(gid);
+  g.gen.generation = 0;
+  g.traits.fill(0);
+  g.cdata = genotype::BOCData::random(dice);
+  return g;
+}
+
+Genome Genome::random (phylogeny::GID gid, Dice &dice) {
+  Genome g = primordial(gid, dice);
+  for (float &t: g.traits)  t = dice(std::normal_distribution<float>(0, 1));
+  return g;
+}
+
+void Genome::mutate (Dice &dice) {
+  std::normal_distribution<float> mutation (0, Mutations::strength);
+  for (float &t: traits)
+    if (dice(Mutations::rate))  t += dice(mutation);
+  cdata.mutate(dice);
+}
+
+double distance (const Genome &lhs, const Genome &rhs) {
+  double d = 0;
+  for (uint i=0; i<Genome::N; i++)
+    d += std::fabs(lhs.traits[i] - rhs.traits[i]);
+  return d / Genome::N;
+}
+
+Genome cross (const Genome &mother, const Genome &father, Genome::Dice &dice) {
+  Genome child;
+  for (uint i=0; i<Genome::N; i++)
+    child.traits[i] = dice.toss(mother.traits[i], father.traits[i]);
+  child.cdata = mother.cdata.crossover(father.cdata, dice);
+  return child;
+}
+
+void to_json (nlohmann::json &j, const Genome &g) {
+  j = {g.gen, g.traits, g.cdata};
+}
+
+void from_json (const nlohmann::json &j, Genome &g) {
+  g.gen = j[0];
+  g.traits = j[1];
+  g.cdata = j[2];
+}
+
+void assertEqual (const Genome &lhs, const Genome &rhs, bool deepcopy) {
+  using utils::assertEqual;
+  assertEqual(lhs.gen.self.gid, rhs.gen.self.gid, deepcopy);
+  for (uint i=0; i<Genome::N; i++)
+    assertEqual(lhs.traits[i], rhs.traits[i], deepcopy);
+  assertEqual(lhs.cdata, rhs.cdata, deepcopy);
+}
+
+} // end of namespace synthetic
@@ -0,0 +1,84 @@
+#ifndef KGD_APOGET_SYNTHETIC_DRIVER_GENOME_H
+#define KGD_APOGET_SYNTHETIC_DRIVER_GENOME_H
+
+/*!
+ * \file genome.h
+ *
+ * Contains the definition of the evolvable genome manipulated by the synthetic
+ * population driver
+ */
+
+#include <array>
+
+#include "../core/crossover.h"
+
+namespace synthetic {
+
+/// Minimal sexually-reproducing genome: a fixed number of real-valued traits
+/// plus the crossover control data used by genotype::bailOutCrossver
+struct Genome {
+  /// Number of traits
+  static constexpr uint N = 8;
+
+  /// Helper alias to the source of randomness
+  using Dice = genotype::BOCData::Dice;
+
+  /// Mutation parameters shared by all genomes
+  /// \warning Set by the Driver: concurrent drivers share the same values
+  struct Mutations {
+    static float rate;      ///< Per-trait mutation probability
+    static float strength;  ///< Standard deviation of a trait mutation
+  };
+
+  phylogeny::Genealogy gen;  ///< Genealogic data
+  std::array<float, N> traits;  ///< Genetic contents
+  genotype::BOCData cdata;   ///< Crossover control data
+
+  /// \returns the genealogic data
+  const phylogeny::Genealogy& genealogy (void) const {  return gen;  }
+
+  /// \returns the identificator of this genome
+  phylogeny::GID id (void) const {  return gen.self.gid;  }
+
+  /// \returns the sex this genome codes for
+  genotype::BOCData::Sex sex (void) const { return cdata.sex;  }
+
+  /// \returns a primordial genome (all traits at zero, random crossover data)
+  /// with identificator \p gid
+  static Genome primordial (phylogeny::GID gid, Dice &dice);
+
+  /// \returns a genome with random traits (i-e far away from everyone else)
+  /// and identificator \p gid
+  static Genome random (phylogeny::GID gid, Dice &dice);
+
+  /// \returns the compatibility with a genome at distance \p d
+  double compatibility (double d) const {
+    return cdata(d);
+  }
+
+  /// Mutates each trait with probability Mutations::rate and the crossover
+  /// data
+  void mutate (Dice &dice);
+
+  /// \returns the distance between \p lhs and \p rhs
+  friend double distance (const Genome &lhs, const Genome &rhs);
+
+  /// \returns an offspring of \p mother and \p father with uniformly
+  /// recombined traits (genealogy left untouched)
+  friend Genome cross (const Genome &mother, const Genome &father,
+                       Dice &dice);
+
+  /// Serializes a genome into a json
+  friend void to_json (nlohmann::json &j, const Genome &g);
+
+  /// Deserializes a genome from a json
+  friend void from_json (const nlohmann::json &j, Genome &g);
+
+  /// Asserts that two genomes are equal
+  friend void assertEqual (const Genome &lhs, const Genome &rhs,
+                           bool deepcopy);
+};
+
+} // end of namespace synthetic
+
+#endif // KGD_APOGET_SYNTHETIC_DRIVER_GENOME_H
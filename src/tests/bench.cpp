@@ -0,0 +1,416 @@
+#include <chrono>
+#include <fstream>
+
+#ifdef __unix__
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "kgd/external/cxxopts.hpp"
+
+#include "fabricatedtree.h"
+#include "costs.h"
+
+/*!
+ * \file bench.cpp
+ *
+ * Contains the &nbsp; \copydoc main
+ */
+
+using Driver = synthetic::Driver;
+using PTree = Driver::Tree;
+using Genome = synthetic::Genome;
+using GID = phylogeny::GID;
+using SID = phylogeny::SID;
+using json = nlohmann::json;
+using Clock = Costs::Clock;
+
+/// Tree exposing the internals under benchmark
+class BenchTree : public FabricatedTree {
+public:
+  using FabricatedTree::FabricatedTree;
+
+  /// \returns the total number of enveloppe points and of stored
+  /// intra-enveloppe distances
+  std::pair<size_t, size_t> enveloppeSizes (void) const {
+    std::pair<size_t, size_t> sizes {0, 0};
+    for (const auto &p: _nodes) {
+      sizes.first += p.second->rset->size();
+      sizes.second += p.second->distances->size();
+    }
+    return sizes;
+  }
+
+  using PTree::findBestDerived;
+  using PTree::performStillbornTrimming;
+  using PTree::updateElligibilities;
+};
+
+/// \returns the peak resident set size of the process (in KiB, 0 if unknown)
+long peakRSS (void) {
+#ifdef __unix__
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0)  return usage.ru_maxrss;
+#endif
+  return 0;
+}
+
+/// \returns the current resident set size of the process (in KiB, 0 if
+/// unknown)
+long currentRSS (void) {
+#ifdef __linux__
+  long pages = 0;
+  std::ifstream statm ("/proc/self/statm");
+  if (statm >> pages >> pages)  return pages * (sysconf(_SC_PAGESIZE) / 1024);
+#endif
+  return 0;
+}
+
+/// \returns the \p q-th quantile of \p values (which are partially reordered)
+template <typename T>
+T quantile (std::vector<T> &values, double q) {
+  if (values.empty()) return T(0);
+  auto nth = values.begin() + size_t(q * (values.size() - 1));
+  std::nth_element(values.begin(), nth, values.end());
+  return *nth;
+}
+
+/// Prints the \p costs of \p ops operations (of type \p unit) of benchmark
+/// \p name with parameters \p params as a single json line
+void report (const std::string &name, json params, const std::string &unit,
+             size_t ops, const Costs &costs) {
+  ops = std::max<size_t>(ops, 1);
+  json j = {
+    { "benchmark", name },
+    { "params", std::move(params) },
+    { "unit", unit },
+    { "ops", ops },
+    { "ns_per_op", 1e9 * costs.seconds / ops },
+    { "allocs_per_op", double(costs.allocations) / ops },
+    { "bytes_per_op", double(costs.bytes) / ops },
+    { "peak_heap_bytes", costs.peak },
+    { "peak_rss_kib", peakRSS() }
+  };
+  std::cout << j << std::endl;
+}
+
+/// Evolves \p pt according to \p params, accounting for the (non-primordial)
+/// insertions in \p insertions and calling \p onGeneration(driver) after
+/// each generation
+template <typename F>
+void evolve (PTree &pt, const synthetic::Parameters &params, Costs &insertions,
+             F onGeneration) {
+  Driver driver (pt, params);
+  for (uint t=1; t<=params.generations; t++) {
+    driver.step(insertions);
+    onGeneration(driver);
+  }
+}
+
+/// Shared parameters
+struct Options {
+  synthetic::Parameters evolution;  ///< Parameters of the evolved trees
+  uint repeats = 5;         ///< Repetitions of the shorter benchmarks
+  std::string folder = "."; ///< Where to store the saved trees
+  uint soakSteps = 100000;  ///< Number of generations of the soak run
+  uint soakPeriod = 1000;   ///< Generations between two soak samples
+};
+
+/// addGenome throughput against the enveloppe size and the number of species
+/// (sampled at regular intervals along an evolution)
+void benchAddGenome (const Options &o, const std::vector<uint> &rsetSizes) {
+  const uint generations = o.evolution.generations, windows = 4,
+             window = std::max(1u, generations / windows);
+  for (uint k: rsetSizes) {
+    BenchTree pt (k);
+    Costs costs;
+    size_t births = o.evolution.population;
+    evolve(pt, o.evolution, costs, [&] (const Driver &d) {
+      const uint t = d.currentStep();
+      if (t % window != 0 && t != generations)  return;
+      report("addGenome",
+             {{"rsetSize", k}, {"generation", t}, {"species", pt.width()}},
+             "genome", d.stats().births - births, costs);
+      costs = Costs();
+      births = d.stats().births;
+    });
+  }
+}
+
+/// findBestDerived when no subspecies matches (i.e. all must be scored)
+void benchFindBestDerived (const Options &o, const std::vector<uint> &fanOuts) {
+  const uint queries = 100 * o.repeats;
+  for (uint f: fanOuts) {
+    BenchTree pt;
+    pt.fanOut(f, o.evolution.seed);
+
+    Driver::Dice dice (o.evolution.seed + 1);
+    std::vector<Genome> genomes;
+    for (uint i=0; i<queries; i++)
+      genomes.push_back(Genome::random(GID(1u<<30 | i), dice));
+
+    Costs costs;
+    costs([&pt, &genomes] {
+      for (const Genome &g: genomes) {
+        PTree::Node_ptr best = nullptr;
+        float bestScore = -std::numeric_limits<float>::max();
+        PTree::DCCache dccache;
+        pt.findBestDerived(g, { pt.root() }, best, bestScore, dccache);
+      }
+    });
+    report("findBestDerived", {{"fanOut", f}}, "call", queries, costs);
+  }
+}
+
+/// Each enveloppe criterion on random full enveloppes
+void benchComputeContribution (const Options &o,
+                               const std::vector<uint> &rsetSizes) {
+  using namespace phylogeny::_details;
+  using Criterion = EnveloppeContribution (*) (const DistanceMap&,
+                                               const std::vector<float>&,
+                                               GID, const std::vector<GID>&);
+  static const std::vector<std::pair<std::string, Criterion>> criteria {
+    { "maxAverage", maxAverage },
+    { "maxMinDist", maxMinDist },
+    { "maxAvgMinStdDev", maxAvgMinStdDev },
+    { "maxWeightedDist2Avg", maxWeightedDist2Avg },
+  };
+
+  const uint samples = 1000 * o.repeats;
+  for (uint k: rsetSizes) {
+    std::mt19937 rng (o.evolution.seed);
+    std::uniform_real_distribution<float> dist (0, 1);
+
+    DistanceMap edist;
+    std::vector<GID> ids (k);
+    for (uint i=0; i<k; i++) {
+      ids[i] = GID(i);
+      for (uint j=0; j<i; j++)  edist[{j, i}] = dist(rng);
+    }
+
+    std::vector<std::vector<float>> gdists (samples, std::vector<float>(k));
+    for (auto &gdist: gdists)
+      for (float &d: gdist) d = dist(rng);
+
+    for (const auto &c: criteria) {
+      Costs costs;
+      uint better = 0;
+      costs([&] {
+        for (const auto &gdist: gdists)
+          better += c.second(edist, gdist, GID(k), ids).better;
+      });
+      report("computeContribution",
+             {{"criterion", c.first}, {"rsetSize", k}, {"better", better}},
+             "call", samples, costs);
+    }
+  }
+}
+
+/// Tree-wide maintenance (stillborn trimming, elligibilities) on an evolved
+/// tree
+void benchMaintenance (const Options &o) {
+  BenchTree pt;
+  Costs ignored;
+  evolve(pt, o.evolution, ignored, [] (const Driver&) {});
+  const uint species = pt.width();
+
+  // Age the copies so that every underfilled extinct leaf is trimmable
+  const uint step = pt.step() + config::PTree::stillbornTrimmingMinDelay()
+                  + config::PTree::stillbornTrimmingDelay() * pt.step() + 1;
+  std::vector<BenchTree> copies (o.repeats, pt);
+  for (BenchTree &c: copies)  c.setStep(step);
+
+  Costs trimming;
+  trimming([&copies] {
+    for (BenchTree &c: copies)  c.performStillbornTrimming();
+  });
+  report("performStillbornTrimming",
+         {{"species", species}, {"remaining", copies.front().width()}},
+         "call", copies.size(), trimming);
+
+  Costs elligibilities;
+  elligibilities([&pt, &o] {
+    for (uint i=0; i<o.repeats; i++)  pt.updateElligibilities();
+  });
+  report("updateElligibilities", {{"species", species}}, "call", o.repeats,
+         elligibilities);
+}
+
+/// saveTo/readFrom for every supported format
+void benchSerialization (const Options &o) {
+  BenchTree pt;
+  Costs ignored;
+  evolve(pt, o.evolution, ignored, [] (const Driver&) {});
+  const uint species = pt.width();
+
+  for (std::string ext: { ".json", ".json.gz", ".ptb", ".ptb.gz" }) {
+    const std::string file = o.folder + "/bench_tree" + ext;
+    const bool binary = (ext.find(".ptb") != std::string::npos);
+    const json params = {{"format", ext}, {"species", species}};
+
+    Costs save;
+    save([&pt, &o, &file, binary] {
+      for (uint i=0; i<o.repeats; i++)
+        if (!(binary ? pt.saveBinaryTo(file) : pt.saveTo(file)))
+          utils::doThrow<std::runtime_error>("Failed to save to ", file);
+    });
+    report("saveTo", params, "call", o.repeats, save);
+
+    for (auto mode: { phylogeny::LoadMode::EAGER, phylogeny::LoadMode::LAZY }) {
+      Costs load;
+      load([&o, &file, mode] {
+        for (uint i=0; i<o.repeats; i++)  PTree::readFrom(file, mode);
+      });
+      json p = params;
+      p["mode"] = (mode == phylogeny::LoadMode::LAZY ? "lazy" : "eager");
+      report("readFrom", p, "call", o.repeats, load);
+    }
+  }
+}
+
+/// Long synthetic run sampling, every Options::soakPeriod generations, the
+/// process and tree sizes along with the insertion latencies and trimming
+/// time. The time series is written (as csv) to <folder>/soak.csv
+void benchSoak (const Options &o) {
+  const std::string file = o.folder + "/soak.csv";
+  std::ofstream ofs (file);
+  if (!ofs)  utils::doThrow<std::runtime_error>("Failed to open ", file);
+  ofs << "step,seconds,rss_kib,heap_bytes,species,alive,population,"
+         "rset_total,distances_total,add_p50_ns,add_p99_ns,add_max_ns,"
+         "trimmings,trimming_ns,tree_bytes_estimate,tree_bytes\n";
+
+  const uint period = std::max(1u, o.soakPeriod);
+  const uint T = config::PTree::stillbornTrimmingPeriod();
+
+  BenchTree pt;
+  synthetic::Parameters params = o.evolution;
+  params.generations = o.soakSteps;
+  Driver driver (pt, params);
+
+  std::vector<double> latencies;
+  double trimming = 0;
+  uint trimmings = 0;
+  auto start = Clock::now();
+
+  auto timeInsertion = [&latencies] (auto &&insert) {
+    auto t0 = Clock::now();
+    insert();
+    latencies.push_back(
+      std::chrono::duration<double, std::nano>(Clock::now() - t0).count());
+  };
+
+  // Trimming happens within the tree stepping (every T generations)
+  auto timeStep = [&] (auto &&stepTree) {
+    bool trims = (T > 0) && ((driver.currentStep() % T) == 0);
+    auto t0 = Clock::now();
+    stepTree();
+    if (trims) {
+      trimming += std::chrono::duration<double, std::nano>(
+                    Clock::now() - t0).count();
+      trimmings++;
+    }
+  };
+
+  for (uint t=1; t<=params.generations; t++) {
+    driver.step(timeInsertion, timeStep);
+    if (t % period != 0 && t != params.generations)  continue;
+
+    auto sizes = pt.enveloppeSizes();
+    double max = latencies.empty() ? 0
+               : *std::max_element(latencies.begin(), latencies.end());
+    double p50 = quantile(latencies, .5), p99 = quantile(latencies, .99);
+    ofs << t << ","
+        << std::chrono::duration<double>(Clock::now() - start).count() << ","
+        << currentRSS() << "," << heap::current << ","
+        << pt.width() << "," << pt.aliveSpecies().size() << ","
+        << driver.population().size() << ","
+        << sizes.first << "," << sizes.second << ","
+        << p50 << "," << p99 << "," << max << ","
+        << trimmings << "," << trimming << ","
+        << pt.memoryEstimate().total() << ","
+        << pt.memoryFootprint().total() << std::endl;
+
+    latencies.clear();
+    trimming = 0;
+    trimmings = 0;
+  }
+
+  std::cout << json{
+    { "benchmark", "soak" },
+    { "params", params },
+    { "output", file },
+    { "species", pt.width() },
+    { "peak_rss_kib", peakRSS() }
+  } << std::endl;
+}
+
+/// Runs the core benchmarks and prints one json object per line, e.g.
+/// {"benchmark":"findBestDerived","params":{"fanOut":100},"unit":"call",
+///  "ops":500,"ns_per_op":...,"allocs_per_op":...,"bytes_per_op":...,
+///  "peak_heap_bytes":...,"peak_rss_kib":...}
+///
+/// The (opt-in) soak benchmark instead writes a time series to soak.csv
+int main(int argc, char *argv[]) {
+  Options o;
+  std::string configFile;
+  std::vector<std::string> benchmarks {
+    "addGenome", "findBestDerived", "computeContribution", "maintenance",
+    "serialization"
+  };
+  std::vector<uint> rsetSizes { 3, 5, 10 }, fanOuts { 10, 100, 1000 };
+
+  cxxopts::Options options("Bench",
+                           "Micro and macro benchmarks of the phylogeny core");
+  options.add_options()
+    ("h,help", "Display help")
+    ("c,config", "File containing configuration data",
+     cxxopts::value(configFile))
+    ("b,benchmarks", "Comma-separated list of benchmarks to run",
+     cxxopts::value(benchmarks))
+    ("k,rset-sizes", "Comma-separated enveloppe sizes",
+     cxxopts::value(rsetSizes))
+    ("f,fan-outs", "Comma-separated numbers of subspecies",
+     cxxopts::value(fanOuts))
+    ("p,population", "Number of individuals per generation",
+     cxxopts::value(o.evolution.population))
+    ("l,litter", "Number of offsprings per successful mating",
+     cxxopts::value(o.evolution.litter))
+    ("g,generations", "Number of generations",
+     cxxopts::value(o.evolution.generations))
+    ("m,mutation-rate", "Per-trait mutation probability",
+     cxxopts::value(o.evolution.mutationRate))
+    ("M,mutation-strength", "Standard deviation of a trait mutation",
+     cxxopts::value(o.evolution.mutationStrength))
+    ("r,repeats", "Repetitions of the shorter benchmarks",
+     cxxopts::value(o.repeats))
+    ("d,folder", "Where to store the saved trees", cxxopts::value(o.folder))
+    ("soak-steps", "Number of generations of the soak benchmark",
+     cxxopts::value(o.soakSteps))
+    ("soak-period", "Generations between two soak samples",
+     cxxopts::value(o.soakPeriod))
+    ("s,seed", "Seed for the random number generator", cxxopts::value(o.evolution.seed))
+    ;
+
+  auto result = options.parse(argc, argv);
+  if (result.count("help")) {
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  config::PTree::setupConfig(configFile, config::Verbosity::QUIET);
+
+  for (const std::string &b: benchmarks) {
+    if (b == "addGenome")                 benchAddGenome(o, rsetSizes);
+    else if (b == "findBestDerived")      benchFindBestDerived(o, fanOuts);
+    else if (b == "computeContribution")  benchComputeContribution(o, rsetSizes);
+    else if (b == "maintenance")          benchMaintenance(o);
+    else if (b == "serialization")        benchSerialization(o);
+    else if (b == "soak")                 benchSoak(o);
+    else {
+      std::cerr << "Unknown benchmark '" << b << "'\n";
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,182 @@
+#include "kgd/external/cxxopts.hpp"
+
+#include "../core/tree/mappedtree.h"
+#include "fabricatedtree.h"
+#include "costs.h"
+
+/*!
+ * \file bulkloading.cpp
+ *
+ * Contains the &nbsp; \copydoc main
+ */
+
+using PTree = synthetic::Tree;
+using SID = phylogeny::SID;
+using LoadMode = phylogeny::LoadMode;
+using MappedTree = phylogeny::MappedTree;
+
+/// Loads \p file with \p loader and reports duration and peak heap usage
+template <typename F>
+void measure (const std::string &name, size_t species,
+              const std::string &file, F loader) {
+  PTree pt;
+  Costs costs;
+  costs([&] { loader(file, pt); });
+
+  if (pt.width() != species)
+    utils::doThrow<std::logic_error>("Loaded ", pt.width(), " species out of ",
+                                     species, " with ", name);
+
+  std::cout << name << " " << species << " " << costs.seconds << " "
+            << 1e6 * costs.seconds / species << " "
+            << Costs::MiB(costs.peak) << std::endl;
+}
+
+/// Checks that the memory-mapped view of binary tree \p file matches \p pt
+/// (hierarchy, species data, contributors and enveloppe sizes). Throws on
+/// failure
+void checkMapped (const std::string &file, const PTree &pt) {
+  MappedTree mt (file);
+  if (mt.width() != pt.width() || mt.step() != pt.step()
+      || mt.rsetSize() != pt.rsetSize() || mt.nextNodeID() != pt.nextNodeID())
+    utils::doThrow<std::logic_error>("Mapped header of ", file,
+                                     " does not match the loaded tree");
+
+  auto alive = mt.aliveSpecies();
+  if (!std::equal(alive.begin(), alive.end(),
+                  pt.aliveSpecies().begin(), pt.aliveSpecies().end(),
+                  [] (uint32_t lhs, SID rhs) { return SID(lhs) == rhs; }))
+    utils::doThrow<std::logic_error>("Mapped alive species do not match");
+
+  // Records in file order (pre-order), through the bounds-checked accessor
+  for (uint i=0; i<mt.width(); i++)
+    if (!pt.nodeAt(mt.nodeAtIndex(i).id()))
+      utils::doThrow<std::logic_error>("Unknown mapped species at ", i);
+
+  std::vector<const PTree::Node*> stack { pt.root().get() };
+  while (!stack.empty()) {
+    const PTree::Node *n = stack.back();
+    stack.pop_back();
+
+    MappedTree::Node m = mt.nodeAt(n->id());
+    const auto fail = [n] (const char *what) {
+      utils::doThrow<std::logic_error>("Mapped ", what, " of species ",
+                                       n->id(), " do not match");
+    };
+
+    SID parent = n->parent() ? n->parent()->id() : SID::INVALID;
+    if ((m.parent() ? m.parent().id() : SID::INVALID) != parent)
+      fail("parent");
+    if (!(m.data() == n->data)) fail("data");
+    if (m.rsetSize() != n->rset->size()) fail("enveloppe size");
+    if (m.distances().size() != n->distances->size()) fail("distances");
+
+    auto mc = m.contributors();
+    if (!std::equal(mc.begin(), mc.end(),
+                    n->contributors.begin(), n->contributors.end(),
+                    [] (const phylogeny::binary::ContributorRecord &lhs,
+                        const phylogeny::Contributor &rhs) {
+      return SID(lhs.sid) == rhs.speciesID() && lhs.count == rhs.count()
+          && bool(lhs.elligible) == rhs.elligible();
+    }))
+      fail("contributors");
+
+    std::vector<SID> mChildren, pChildren;
+    for (uint32_t c: m.childrenIDs()) mChildren.push_back(SID(c));
+    for (const auto &c: n->children()) {
+      pChildren.push_back(c->id());
+      stack.push_back(c.get());
+    }
+    std::sort(mChildren.begin(), mChildren.end());
+    std::sort(pChildren.begin(), pChildren.end());
+    if (mChildren != pChildren) fail("children");
+  }
+}
+
+/// Maps binary tree \p file, walks its hierarchy and reports duration
+/// and peak heap usage
+void measureMapped (size_t species, const std::string &file) {
+  size_t walked = 0;
+  Costs costs;
+  costs([&] {
+    MappedTree mt (file);
+    std::vector<MappedTree::Node> stack { mt.root() };
+    while (!stack.empty()) {
+      MappedTree::Node n = stack.back();
+      stack.pop_back();
+      walked++;
+      for (uint i=0; i<n.childrenCount(); i++)  stack.push_back(n.child(i));
+    }
+  });
+
+  if (walked != species)
+    utils::doThrow<std::logic_error>("Walked ", walked, " mapped species out"
+                                     " of ", species);
+
+  std::cout << "mapped " << species << " " << costs.seconds << " "
+            << 1e6 * costs.seconds / species << " "
+            << Costs::MiB(costs.peak) << std::endl;
+}
+
+/// Measures how the json and binary loaders scale with the number of species
+/// (from 10^3 to 10^6 by default)
+int main(int argc, char *argv[]) {
+  std::vector<size_t> sizes { 1000, 10000, 100000, 1000000 };
+  uint representatives = 1, seed = 0;
+  std::string configFile, folder = ".";
+
+  cxxopts::Options options("BulkLoading",
+                           "Benchmarks the loaders against the tree size");
+  options.add_options()
+    ("h,help", "Display help")
+    ("c,config", "File containing configuration data",
+     cxxopts::value(configFile))
+    ("n,sizes", "Comma-separated numbers of species",
+     cxxopts::value(sizes))
+    ("r,representatives", "Number of genomes per species",
+     cxxopts::value(representatives))
+    ("f,folder", "Where to store the generated trees",
+     cxxopts::value(folder))
+    ("s,seed", "Seed for the random number generator", cxxopts::value(seed))
+    ;
+
+  auto result = options.parse(argc, argv);
+  if (result.count("help")) {
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  config::PTree::setupConfig(configFile, config::Verbosity::QUIET);
+
+  const auto dom = [] (LoadMode mode) {
+    return [mode] (const std::string &f, PTree &pt) {
+      PTree::fromJson(phylogeny::json::parse(utils::readAll(f)), pt, mode);
+    };
+  };
+  const auto file = [] (LoadMode mode) {
+    return [mode] (const std::string &f, PTree &pt) {
+      pt = PTree::readFrom(f, mode);
+    };
+  };
+
+  std::cout << "Loader Species Seconds UsPerSpecies PeakMiB\n";
+  for (size_t species: sizes) {
+    std::string base = folder + "/bulk_" + std::to_string(species);
+    {
+      FabricatedTree pt;
+      pt.randomHierarchy(species, representatives, seed);
+      if (!pt.saveTo(base + ".json") || !pt.saveBinaryTo(base + ".ptb"))
+        return 1;
+    }
+
+    measure("dom", species, base + ".json", dom(LoadMode::EAGER));
+    measure("sax", species, base + ".json", file(LoadMode::EAGER));
+    measure("sax-lazy", species, base + ".json", file(LoadMode::LAZY));
+    measure("binary", species, base + ".ptb", file(LoadMode::EAGER));
+    measure("binary-lazy", species, base + ".ptb", file(LoadMode::LAZY));
+    measureMapped(species, base + ".ptb");
+    checkMapped(base + ".ptb", PTree::readFrom(base + ".ptb"));
+  }
+
+  return 0;
+}
@@ -0,0 +1,301 @@
+#include <memory>
+
+#include "kgd/external/cxxopts.hpp"
+
+#include "../synthetic/driver.h"
+
+/*!
+ * \file checkpoints.cpp
+ *
+ * Contains the &nbsp; \copydoc main
+ */
+
+using Parameters = synthetic::Parameters;
+using PTree = synthetic::Tree;
+
+/// Enveloppe point user data counting the writes performed by the checks
+struct Tally {
+  uint writes = 0;  ///< Number of writes
+
+  Tally (void) {}             ///< Default constructor for nlohmann::json
+  Tally (phylogeny::GID) {}   ///< Discards provided id
+  void removedFromEnveloppe (void) const {} ///< Nothing to do
+
+  /// Serializes \p t into a json
+  friend void to_json (nlohmann::json &j, const Tally &t) {
+    j = t.writes;
+  }
+
+  /// Deserializes \p t from a json
+  friend void from_json (const nlohmann::json &j, Tally &t) {
+    t.writes = j;
+  }
+
+  /// Asserts that two tallies are equal
+  friend void assertEqual (const Tally &lhs, const Tally &rhs, bool deepcopy) {
+    utils::assertEqual(lhs.writes, rhs.writes, deepcopy);
+  }
+};
+
+/// Tree whose enveloppe points carry a Tally
+using TallyTree = phylogeny::PhylogeneticTree<synthetic::Genome, Tally>;
+
+/// Pointers to the user data of the enveloppe points in \p d's population,
+/// as held by a simulation
+template <typename DRIVER>
+std::vector<std::pair<phylogeny::PID, Tally*>> holdUserData (DRIVER &d,
+                                                             TallyTree &pt) {
+  std::vector<std::pair<phylogeny::PID, Tally*>> held;
+  for (const synthetic::Genome &g: d.population())
+    if (Tally *t = pt.getUserData(g.gen.self))  held.emplace_back(g.gen.self, t);
+  return held;
+}
+
+/// Checks that the user data pointers held across a copy of the tree keep
+/// designating the live tree's data once its enveloppes are detached from the
+/// copy (by \p period steps of evolution), and outlive that copy (throws
+/// otherwise)
+void checkUserDataCopies (const Parameters &p, uint period) {
+  TallyTree pt;
+  synthetic::BasicDriver<TallyTree> driver (pt, p);
+  for (uint i=0; i<period; i++) driver.step();
+
+  auto held = holdUserData(driver, pt);
+  uint checked = 0;
+  {
+    const TallyTree copy (pt);
+    for (uint i=0; i<period; i++) driver.step();
+
+    for (auto &h: held) {
+      // Genomes that left their enveloppe have no user data anymore
+      if (pt.getUserData(h.first) == nullptr)  continue;
+      if (pt.getUserData(h.first) != h.second)
+        utils::doThrow<std::logic_error>(
+          "User data of ", h.first, " moved out of the live tree");
+
+      h.second->writes++;
+      utils::assertEqual(copy.getUserData(h.first)->writes, 0u, false);
+      checked++;
+    }
+  }
+
+  // The copy is gone: pointers must still be valid
+  for (auto &h: held) {
+    if (pt.getUserData(h.first) == nullptr)  continue;
+    h.second->writes++;
+    utils::assertEqual(pt.getUserData(h.first)->writes, 2u, false);
+  }
+
+  if (checked == 0)
+    utils::doThrow<std::logic_error>("No user data survived ", period,
+                                     " steps: increase the population");
+
+  std::cout << "copies: " << checked << " user data pointers survived a copy"
+            << std::endl;
+}
+
+/// Evolves a tree through \p DRIVER for \p p.generations, saving a full
+/// binary checkpoint first and then a delta every \p period steps. After each
+/// delta, checks that the base and deltas rebuild the live tree exactly
+/// (throws otherwise)
+template <typename DRIVER>
+void checkDeltas (const std::string &name, const Parameters &p, uint period,
+                  const std::string &folder) {
+  typename DRIVER::Tree pt;
+  DRIVER driver (pt, p);
+
+  const std::string base = folder + "/" + name + "_base.ptb";
+  if (!pt.saveBinaryTo(base))
+    utils::doThrow<std::runtime_error>("Failed to save to ", base);
+  pt.markClean();
+
+  std::vector<std::string> deltas;
+  for (uint i=1; i<=p.generations; i++) {
+    driver.step();
+    if (i % period != 0 && i != p.generations)  continue;
+
+    deltas.push_back(folder + "/" + name + "_delta_" + std::to_string(i)
+                     + ".ptb");
+    if (!pt.saveDeltaTo(deltas.back()))
+      utils::doThrow<std::runtime_error>("Failed to save to ", deltas.back());
+
+    assertEqual(PTree::readFrom(base, deltas), pt, true);
+  }
+
+  // An unchanged population must not mark its species as modified, yet their
+  // last appearance must survive the next delta (stillborn trimming would
+  // legitimately touch the parents of removed species)
+  const auto &T = config::PTree::stillbornTrimmingPeriod();
+  uint idle = pt.step() + 1;
+  if (T > 0 && idle % T == 0) idle++;
+  const phylogeny::LivingSet alive = pt.aliveSpecies();
+  pt.step(idle, alive.begin(), alive.end(), [] (phylogeny::SID sid) {
+    return sid;
+  });
+  for (phylogeny::SID sid: alive)
+    if (pt.nodeAt(sid)->dirty)
+      utils::doThrow<std::logic_error>("Species ", sid, " was modified by an",
+                                       " unchanged population");
+  deltas.push_back(folder + "/" + name + "_delta_idle.ptb");
+  if (!pt.saveDeltaTo(deltas.back()))
+    utils::doThrow<std::runtime_error>("Failed to save to ", deltas.back());
+  assertEqual(PTree::readFrom(base, deltas), pt, true);
+
+  std::cout << name << ": rebuilt " << deltas.size() << " deltas ("
+            << pt.width() << " species at step " << pt.step() << ")"
+            << std::endl;
+}
+
+/// Evolves a journaled tree for \p p.generations, saving a full checkpoint
+/// every \p period steps. At each of these, checks that both a tree replaying
+/// the journal from scratch and the previous checkpoint replaying it from
+/// JournalReader::seek() rebuild the live tree exactly, and that concurrent
+/// trees refuse to be journaled (throws otherwise)
+void checkJournal (const Parameters &p, uint period, const std::string &folder) {
+  const std::string journal = folder + "/journal.aptj";
+  phylogeny::JournalWriter writer (journal);
+
+  // Concurrent insertions cannot be replayed and must be rejected upfront
+  bool rejected = false;
+  try {
+    synthetic::ConcurrentTree cpt;
+    cpt.setJournal(&writer);
+  } catch (const std::logic_error&) {
+    rejected = true;
+  }
+  if (!rejected)
+    utils::doThrow<std::logic_error>("Concurrent tree accepted a journal");
+
+  PTree pt;
+  pt.setJournal(&writer);
+  synthetic::Driver driver (pt, p);
+
+  PTree replayed;
+  std::unique_ptr<phylogeny::JournalReader> reader;
+  std::string checkpoint;
+  uint checkpointStep = 0, checks = 0;
+  for (uint i=1; i<=p.generations; i++) {
+    driver.step();
+    if (i % period != 0 && i != p.generations)  continue;
+
+    writer.flush();
+    if (!reader)  reader = std::make_unique<phylogeny::JournalReader>(journal);
+
+    // Incremental replay from the empty tree
+    if (!replayed.replay(*reader, i))
+      utils::doThrow<std::logic_error>("Journal ended before step ", i);
+    assertEqual(replayed, pt, true);
+
+    // Replay from the previous checkpoint
+    if (!checkpoint.empty()) {
+      PTree resumed = PTree::readFrom(checkpoint);
+      phylogeny::JournalReader r (journal);
+      r.seek(checkpointStep);
+      if (!resumed.replay(r, i))
+        utils::doThrow<std::logic_error>("Journal ended before step ", i);
+      assertEqual(resumed, pt, true);
+    }
+
+    checkpoint = folder + "/journal_" + std::to_string(i) + ".ptb";
+    if (!pt.saveBinaryTo(checkpoint))
+      utils::doThrow<std::runtime_error>("Failed to save to ", checkpoint);
+    checkpointStep = i;
+    checks++;
+  }
+
+  std::cout << "journal: replayed " << checks << " steps ("
+            << pt.width() << " species at step " << pt.step() << ")"
+            << std::endl;
+}
+
+/// Evolves a tree with user data for \p p.generations, saving it in the
+/// background every \p period steps. While a save is in flight, the user data
+/// held by the simulation is written to and the tree keeps evolving. Checks
+/// that each save holds the state at the time of the call and that the
+/// writes reached the live tree (throws otherwise)
+void checkAsyncSaves (const Parameters &p, uint period,
+                      const std::string &folder) {
+  TallyTree pt;
+  synthetic::BasicDriver<TallyTree> driver (pt, p);
+
+  uint saves = 0;
+  for (uint i=1; i<=p.generations; i++) {
+    driver.step();
+    if (i % period != 0)  continue;
+
+    const std::string file = folder + "/async_" + std::to_string(i) + ".json";
+    const TallyTree reference (pt);
+    auto held = holdUserData(driver, pt);
+    std::shared_future<bool> saved = pt.saveToAsync(file);
+
+    // Keep on writing and evolving (i.e. detaching enveloppes) meanwhile
+    for (auto &h: held) h.second->writes++;
+    driver.step();
+    for (auto &h: held) h.second->writes++;
+
+    if (!saved.get())
+      utils::doThrow<std::runtime_error>("Failed to save to ", file);
+    assertEqual(TallyTree::readFrom(file), reference, true);
+
+    // The save's copy is gone: the held pointers must designate live data
+    for (auto &h: held) {
+      const Tally *t = pt.getUserData(h.first);
+      if (!t) continue;
+      if (t != h.second)
+        utils::doThrow<std::logic_error>(
+          "User data of ", h.first, " moved out of the live tree");
+      utils::assertEqual(t->writes,
+                         reference.getUserData(h.first)->writes + 2, false);
+    }
+    saves++;
+  }
+
+  std::cout << "async: checked " << saves << " background saves ("
+            << pt.width() << " species at step " << pt.step() << ")"
+            << std::endl;
+}
+
+/// Checks that the incremental persistence mechanisms rebuild the exact state
+/// of a synthetic evolution (delta checkpoints on both the sequential and
+/// concurrent trees, journal replays on the sequential one) and that copies
+/// of the tree, including those of background saves, do not steal the user
+/// data held by the simulation
+int main(int argc, char *argv[]) {
+  Parameters p;
+  uint period = 10;
+  std::string configFile, folder = ".";
+
+  cxxopts::Options options("Checkpoints",
+                           "Checks that delta checkpoints and journal"
+                           " replays rebuild the live tree of a synthetic"
+                           " evolution");
+  options.add_options()
+    ("h,help", "Display help")
+    ("c,config", "File containing configuration data",
+     cxxopts::value(configFile))
+    ("p,population", "Number of individuals per generation",
+     cxxopts::value(p.population))
+    ("g,generations", "Number of generations", cxxopts::value(p.generations))
+    ("s,seed", "Seed for the random number generator", cxxopts::value(p.seed))
+    ("P,period", "Number of generations between two checks",
+     cxxopts::value(period))
+    ("f,folder", "Where to store the checkpoints", cxxopts::value(folder))
+    ;
+
+  auto result = options.parse(argc, argv);
+  if (result.count("help")) {
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  config::PTree::setupConfig(configFile, config::Verbosity::QUIET);
+  period = std::max(1u, period);
+
+  checkDeltas<synthetic::Driver>("sequential", p, period, folder);
+  checkDeltas<synthetic::ConcurrentDriver>("concurrent", p, period, folder);
+  checkJournal(p, period, folder);
+  checkUserDataCopies(p, period);
+  checkAsyncSaves(p, period, folder);
+
+  return 0;
+}
@@ -0,0 +1,213 @@
+#include <thread>
+#include <chrono>
+
+#include "kgd/external/cxxopts.hpp"
+
+#include "../core/tree/asynccallbacks.h"
+#include "../synthetic/driver.h"
+
+/*!
+ * \file concurrentinsertions.cpp
+ *
+ * Contains the &nbsp; \copydoc main
+ */
+
+using SID = phylogeny::SID;
+using GID = phylogeny::GID;
+
+/// Counts the events delivered by the asynchronous callbacks
+struct EventCounter {
+  uint steps = 0;         ///< Number of step events
+  int lastStep = -1;      ///< Step of the last step event
+  size_t species = 0;     ///< Number of new species events
+  size_t entries = 0;     ///< Number of enveloppe entry events
+  size_t exits = 0;       ///< Number of enveloppe exit events
+  size_t rootings = 0;    ///< Number of major contributor change events
+
+  /// Checks that steps are delivered in order
+  void onStepped (uint step, const phylogeny::LivingSet &) {
+    if (int(step) <= lastStep)
+      utils::doThrow<std::logic_error>("Step ", step, " delivered after ",
+                                       lastStep);
+    lastStep = step;
+    steps++;
+  }
+
+  /// Nothing to count
+  void onSteppedDelta (uint, const phylogeny::LivingDelta &) {}
+
+  /// Counts the new species
+  void onNewSpecies (SID, SID) { species++; }
+
+  /// Counts the enveloppe entries
+  void onGenomeEntersEnveloppe (SID, GID) { entries++; }
+
+  /// Counts the enveloppe exits
+  void onGenomeLeavesEnveloppe (SID, GID) { exits++; }
+
+  /// Counts the rootings changes
+  void onMajorContributorChanged (SID, SID, SID) { rootings++; }
+};
+
+/// Events emitted by the workers are delivered asynchronously
+template <>
+struct phylogeny::Callbacks_t<synthetic::Tree>
+  : phylogeny::AsyncCallbacks<EventCounter> {
+  using AsyncCallbacks::AsyncCallbacks;
+};
+
+using PTree = synthetic::ConcurrentTree;
+using Parameters = synthetic::Parameters;
+using Clock = std::chrono::steady_clock;
+
+/// Checks the structural invariants of \p pt (throws on failure)
+void checkInvariants (const PTree &pt, uint population) {
+  uint alive = 0;
+  std::vector<const PTree::Node*> stack { pt.root().get() };
+  while (!stack.empty()) {
+    const PTree::Node *n = stack.back();
+    stack.pop_back();
+
+    alive += n->data.currentlyAlive;
+    if (n->data.pendingCandidates != 0)
+      utils::doThrow<std::logic_error>("Species ", n->id(), " has ",
+                                       n->data.pendingCandidates,
+                                       " dangling candidacies");
+
+    SID mc = SID::INVALID;
+    for (const phylogeny::Contributor &c: n->contributors)
+      if (c.elligible()) {  mc = c.speciesID(); break;  }
+    if (mc != (n->parent() ? n->parent()->id() : SID::INVALID))
+      utils::doThrow<std::logic_error>("Species ", n->id(),
+                                       " is attached to the wrong parent");
+
+    for (uint i=0; i<n->rset->size(); i++) {
+      phylogeny::PID pid (n->representativeId(i));
+      pid.sid = n->id();
+      auto slot = pt.representative(pid.gid);
+      if (slot.sid != n->id() || slot.slot != i)
+        utils::doThrow<std::logic_error>("Representative ", pid,
+                                         " is not correctly indexed");
+    }
+
+    if (n->distances->size() != n->rset->size() * (n->rset->size() - 1) / 2)
+      utils::doThrow<std::logic_error>("Species ", n->id(),
+                                       " has incoherent distances");
+
+    for (const auto &c: n->children()) {
+      if (c->parent() != n)
+        utils::doThrow<std::logic_error>("Species ", c->id(),
+                                         " is not attached to ", n->id());
+      stack.push_back(c.get());
+    }
+  }
+
+  if (alive != population)
+    utils::doThrow<std::logic_error>("Tree has ", alive, " alive individuals"
+                                     " instead of ", population);
+}
+
+/// Runs a synthetic evolution whose offsprings are inserted by \p threads
+/// workers. If \p async, also checks the events delivered asynchronously.
+/// \returns the number of insertions per second
+double run (const Parameters &p, bool async, uint threads) {
+  PTree pt;
+
+  EventCounter counter;
+  std::unique_ptr<PTree::Callbacks> callbacks;
+  if (async) {
+    callbacks = std::make_unique<PTree::Callbacks>(counter);
+    pt.setCallbacks(callbacks.get());
+  }
+
+  synthetic::ConcurrentDriver driver (pt, p);
+
+  Clock::duration elapsed {0};
+  size_t insertions = 0;
+  const auto insertAll = [&elapsed, &insertions, threads] (size_t n,
+                                                           const auto &insert) {
+    const auto worker = [&insert, n, threads] (uint w) {
+      for (size_t i=w; i<n; i+=threads) insert(i);
+    };
+
+    auto start = Clock::now();
+    std::vector<std::thread> workers;
+    for (uint w=0; w<threads; w++)  workers.emplace_back(worker, w);
+    for (std::thread &w: workers) w.join();
+    elapsed += Clock::now() - start;
+    insertions += n;
+  };
+
+  for (uint t=1; t<=p.generations; t++)
+    driver.stepBatch(insertAll, [] (auto &&stepTree) { stepTree(); });
+
+  checkInvariants(pt, driver.population().size());
+
+  if (callbacks) {
+    callbacks->flush();
+    if (counter.steps != p.generations+1
+        || counter.lastStep != int(p.generations))
+      utils::doThrow<std::logic_error>("Received ", counter.steps,
+                                       " step events instead of ",
+                                       p.generations+1);
+    if (counter.species < pt.width())
+      utils::doThrow<std::logic_error>("Received ", counter.species,
+                                       " new species events for ",
+                                       pt.width(), " species");
+  }
+
+  double seconds = std::chrono::duration<double>(elapsed).count();
+  return insertions / seconds;
+}
+
+/// Stress-tests the concurrent insertion mode and measures its scaling from 1
+/// to N cores
+int main(int argc, char *argv[]) {
+  Parameters p;
+  p.population = 1000;
+  p.generations = 200;
+  p.mutationStrength = .01;
+  bool async = false;
+  uint maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  std::string configFile;
+
+  cxxopts::Options options("ConcurrentInsertions",
+                           "Stress tests and benchmarks concurrent insertions"
+                           " in a phylogenetic tree");
+  options.add_options()
+    ("h,help", "Display help")
+    ("c,config", "File containing configuration data",
+     cxxopts::value(configFile))
+    ("t,threads", "Maximal number of worker threads",
+     cxxopts::value(maxThreads))
+    ("p,population", "Number of individuals per generation",
+     cxxopts::value(p.population))
+    ("g,generations", "Number of generations",
+     cxxopts::value(p.generations))
+    ("m,mutations", "Standard deviation of the traits mutations",
+     cxxopts::value(p.mutationStrength))
+    ("s,seed", "Seed for the random number generator",
+     cxxopts::value(p.seed))
+    ("a,async", "Deliver (and check) the tree events asynchronously",
+     cxxopts::value(async))
+    ;
+
+  auto result = options.parse(argc, argv);
+  if (result.count("help")) {
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  config::PTree::setupConfig(configFile, config::Verbosity::QUIET);
+
+  std::cout << "Threads Insertions/s Speedup\n";
+  double reference = 0;
+  for (uint t=1; t<=maxThreads; t = (t < maxThreads && 2*t > maxThreads) ?
+                                    maxThreads : 2*t) {
+    double ips = run(p, async, t);
+    if (t == 1) reference = ips;
+    std::cout << t << " " << ips << " " << ips / reference << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef KGD_APOGET_COSTS_H
+#define KGD_APOGET_COSTS_H
+
+/*!
+ * \file costs.h
+ *
+ * Contains the time and heap measurement helper shared by the benchmark
+ * executables
+ *
+ * \warning Includes heaptracker.h: include in exactly one translation unit per
+ * executable
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+
+#include "heaptracker.h"
+
+/// Costs accumulated over the measured sections of a benchmark
+struct Costs {
+  /// Helper alias to the clock used for timing
+  using Clock = std::chrono::steady_clock;
+
+  double seconds = 0;      ///< Elapsed time
+  size_t allocations = 0;  ///< Number of heap allocations
+  size_t bytes = 0;        ///< Number of bytes allocated
+  size_t peak = 0;         ///< Maximal heap growth within a section
+  std::ptrdiff_t retained = 0;  ///< Heap growth left by the sections
+
+  /// Runs \p f as a measured section
+  template <typename F>
+  void operator() (F &&f) {
+    size_t allocations0 = heap::allocations, bytes0 = heap::allocated,
+           base = heap::current;
+    heap::resetPeak();
+    auto start = Clock::now();
+
+    f();
+
+    seconds += std::chrono::duration<double>(Clock::now() - start).count();
+    allocations += heap::allocations - allocations0;
+    bytes += heap::allocated - bytes0;
+    peak = std::max<size_t>(peak, heap::peak - base);
+    retained += std::ptrdiff_t(heap::current) - std::ptrdiff_t(base);
+  }
+
+  /// \returns \p bytes in MiB
+  static double MiB (double bytes) {
+    return bytes / (1024. * 1024.);
+  }
+};
+
+#endif // KGD_APOGET_COSTS_H
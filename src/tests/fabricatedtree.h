@@ -0,0 +1,80 @@
+#ifndef KGD_APOGET_FABRICATED_TREE_H
+#define KGD_APOGET_FABRICATED_TREE_H
+
+/*!
+ * \file fabricatedtree.h
+ *
+ * Contains the definition of a synthetic tree whose species are fabricated
+ * directly, for the test and benchmark executables
+ */
+
+#include "../synthetic/driver.h"
+
+/// Tree directly fabricated species by species (without going through
+/// addGenome) so that large or specifically shaped hierarchies can be built
+/// quickly
+class FabricatedTree : public synthetic::Tree {
+public:
+  /// Helper alias to the source of randomness
+  using Dice = synthetic::Genome::Dice;
+
+  /// Creates an empty tree whose species hold (at most) \p rsetSize genomes
+  explicit FabricatedTree (uint rsetSize = config::PTree::rsetSize()) {
+    _rsetSize = rsetSize;
+  }
+
+  /// Fabricates, at the current step, a subspecies of \p parent (or the root
+  /// if SID::INVALID) holding \p representatives random (mutually
+  /// incompatible) genomes
+  /// \returns the identificator of the new species
+  phylogeny::SID addSpecies (phylogeny::SID parent, uint representatives,
+                             Dice &dice) {
+    SpeciesContribution contrib;
+    if (parent != phylogeny::SID::INVALID)  contrib.emplace_back(parent, 1);
+    Node_ptr n = makeNode(contrib);
+    if (!_root) _root = n;
+
+    DCCache dccache;
+    representatives = std::min(representatives, _rsetSize);
+    for (uint r=0; r<representatives; r++) {
+      synthetic::Genome g = synthetic::Genome::random(_gidManager(), dice);
+      dccache.distances.resize(r);
+      for (uint j=0; j<r; j++)
+        dccache.distances[j] = distance(g, (*n->rset)[j].genome);
+      insertInto(_step, g, n, dccache, nullptr);
+    }
+    return n->id();
+  }
+
+  /// Fabricates a primordial species with \p children subspecies, all
+  /// holding a full enveloppe
+  void fanOut (uint children, uint seed) {
+    Dice dice (seed);
+    setStep(0);
+    phylogeny::SID root = addSpecies(phylogeny::SID::INVALID, _rsetSize, dice);
+    setStep(1);  // Subspecies must appear after their parent
+    for (uint i=0; i<children; i++)  addSpecies(root, _rsetSize, dice);
+  }
+
+  /// Grows a random recursive tree (expected depth in O(log species)) of
+  /// \p species species, each holding \p representatives genomes and
+  /// appearing one step after the previous one
+  void randomHierarchy (size_t species, uint representatives, uint seed) {
+    Dice dice (seed);
+    std::vector<phylogeny::SID> sids;
+    sids.reserve(species);
+    for (size_t i=0; i<species; i++) {
+      setStep(i);
+      phylogeny::SID parent = phylogeny::SID::INVALID;
+      if (i > 0)
+        parent = sids[dice(std::uniform_int_distribution<size_t>(0, i-1))];
+      sids.push_back(addSpecies(parent, representatives, dice));
+    }
+  }
+
+private:
+  /// Source of the fabricated genomes identificators
+  phylogeny::GIDManager _gidManager;
+};
+
+#endif // KGD_APOGET_FABRICATED_TREE_H
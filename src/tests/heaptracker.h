@@ -0,0 +1,61 @@
+#ifndef KGD_APOGET_HEAP_TRACKER_H
+#define KGD_APOGET_HEAP_TRACKER_H
+
+/*!
+ * \file heaptracker.h
+ *
+ * Contains a replacement of the global allocation functions tracking heap
+ * usage for the benchmark executables
+ *
+ * \warning Replaces the global operator new/delete: include in exactly one
+ * translation unit per executable
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/// Heap usage tracking
+namespace heap {
+std::atomic<size_t> current {0};  ///< Currently allocated bytes
+std::atomic<size_t> peak {0};     ///< Maximal value of current
+std::atomic<size_t> allocations {0};  ///< Number of allocations so far
+std::atomic<size_t> allocated {0};    ///< Bytes allocated so far
+
+/// Header prepended to each allocation to remember its size
+static constexpr size_t HEADER = alignof(std::max_align_t);
+
+/// Starts a new measurement
+void resetPeak (void) {
+  peak = current.load();
+}
+} // end of namespace heap
+
+/// Tracking allocation
+void* operator new (size_t size) {
+  void *p = std::malloc(size + heap::HEADER);
+  if (!p) throw std::bad_alloc();
+  *static_cast<size_t*>(p) = size;
+
+  heap::allocations++;
+  heap::allocated += size;
+  size_t c = heap::current += size, pk = heap::peak;
+  while (c > pk && !heap::peak.compare_exchange_weak(pk, c));
+
+  return static_cast<char*>(p) + heap::HEADER;
+}
+
+/// Tracking deallocation
+void operator delete (void *p) noexcept {
+  if (!p) return;
+  p = static_cast<char*>(p) - heap::HEADER;
+  heap::current -= *static_cast<size_t*>(p);
+  std::free(p);
+}
+
+/// Tracking deallocation (sized)
+void operator delete (void *p, size_t) noexcept {
+  operator delete(p);
+}
+
+#endif // KGD_APOGET_HEAP_TRACKER_H
@@ -0,0 +1,91 @@
+#include "kgd/external/cxxopts.hpp"
+
+#include "../synthetic/driver.h"
+#include "costs.h"
+
+/*!
+ * \file jsonloading.cpp
+ *
+ * Contains the &nbsp; \copydoc main
+ */
+
+using PTree = synthetic::Tree;
+using Parameters = synthetic::Parameters;
+
+/// Builds a synthetic tree by running a synthetic evolution with parameters
+/// \p p
+PTree generate (const Parameters &p) {
+  PTree pt;
+  synthetic::Driver driver (pt, p);
+  driver.run([] (uint) {});
+  return pt;
+}
+
+/// Loads \p file with \p loader and reports duration and peak heap usage
+template <typename F>
+PTree measure (const std::string &name, const std::string &file, F loader) {
+  PTree pt;
+  Costs costs;
+  costs([&] { loader(file, pt); });
+
+  std::cout << name << " " << costs.seconds << " " << Costs::MiB(costs.peak)
+            << " " << Costs::MiB(costs.retained) << std::endl;
+  return pt;
+}
+
+/// Compares the memory and time consumption of the DOM-based and streaming
+/// json loaders on a synthetic tree (or the provided one)
+int main(int argc, char *argv[]) {
+  Parameters p;
+  p.population = 300;
+  p.generations = 300;
+  std::string configFile, treeFile = "synthetic_tree.json";
+  bool generateTree = true;
+
+  cxxopts::Options options("JsonLoading",
+                           "Benchmarks the json tree loaders");
+  options.add_options()
+    ("h,help", "Display help")
+    ("c,config", "File containing configuration data",
+     cxxopts::value(configFile))
+    ("t,tree", "Use this tree file (synthetic genomes only) instead of"
+               " generating one", cxxopts::value(treeFile))
+    ("p,population", "Number of individuals per generation",
+     cxxopts::value(p.population))
+    ("g,generations", "Number of generations", cxxopts::value(p.generations))
+    ("m,mutations", "Standard deviation of the traits mutations",
+     cxxopts::value(p.mutationStrength))
+    ("s,seed", "Seed for the random number generator", cxxopts::value(p.seed))
+    ;
+
+  auto result = options.parse(argc, argv);
+  if (result.count("help")) {
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+  generateTree = !result.count("tree");
+
+  config::PTree::setupConfig(configFile, config::Verbosity::QUIET);
+
+  if (generateTree) {
+    PTree pt = generate(p);
+    if (!pt.saveTo(treeFile)) return 1;
+    std::cout << "Generated " << pt.width() << " species into " << treeFile
+              << "\n";
+  }
+
+  std::cout << "Loader Seconds PeakMiB FinalMiB\n";
+  PTree dom = measure("dom", treeFile,
+                      [] (const std::string &f, PTree &pt) {
+    PTree::fromJson(phylogeny::json::parse(utils::readAll(f)), pt);
+  });
+
+  PTree sax = measure("sax", treeFile,
+                      [] (const std::string &f, PTree &pt) {
+    std::ifstream ifs (f);
+    PTree::fromJsonStream(ifs, pt);
+  });
+
+  assertEqual(dom, sax, true);
+  return 0;
+}
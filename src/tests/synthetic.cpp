@@ -0,0 +1,121 @@
+#include <chrono>
+
+#include "kgd/external/cxxopts.hpp"
+
+#include "../core/tree/metrics.h"
+#include "../synthetic/driver.h"
+
+/*!
+ * \file synthetic.cpp
+ *
+ * Contains the &nbsp; \copydoc main
+ */
+
+/// Synthetic runs are headless: they are observed through the metrics exporter
+template <>
+struct phylogeny::Callbacks_t<synthetic::Tree>
+  : phylogeny::MetricsObserver<synthetic::Tree> {
+  using MetricsObserver::MetricsObserver;
+};
+
+using Driver = synthetic::Driver;
+using PTree = Driver::Tree;
+using Clock = std::chrono::steady_clock;
+
+/// Runs a standalone synthetic evolution (e.g. for soak runs) and prints the
+/// tree statistics every \c period generations
+int main(int argc, char *argv[]) {
+  synthetic::Parameters p;
+  std::string configFile, output, trace, metrics;
+  uint period = 100, metricsPeriod = 1;
+  bool metricsBinary = false;
+
+  cxxopts::Options options("Synthetic",
+                           "Feeds a phylogenetic tree with a synthetic"
+                           " sexually-reproducing population");
+  options.add_options()
+    ("h,help", "Display help")
+    ("c,config", "File containing configuration data",
+     cxxopts::value(configFile))
+    ("p,population", "Number of individuals per generation",
+     cxxopts::value(p.population))
+    ("l,litter", "Number of offsprings per successful mating",
+     cxxopts::value(p.litter))
+    ("g,generations", "Number of generations", cxxopts::value(p.generations))
+    ("m,mutation-rate", "Per-trait mutation probability",
+     cxxopts::value(p.mutationRate))
+    ("M,mutation-strength", "Standard deviation of a trait mutation",
+     cxxopts::value(p.mutationStrength))
+    ("a,attempts", "Maximal mating attempts per individual",
+     cxxopts::value(p.matingAttempts))
+    ("s,seed", "Seed for the random number generator", cxxopts::value(p.seed))
+    ("P,period", "Number of generations between two stats lines",
+     cxxopts::value(period))
+    ("o,output", "Where to save the final tree (if any)",
+     cxxopts::value(output))
+    ("t,trace", "Where to write the trace events (requires WITH_TRACING)",
+     cxxopts::value(trace))
+    ("metrics", "Where to write the per-step species metrics",
+     cxxopts::value(metrics))
+    ("metrics-period", "Number of steps between two metrics samples",
+     cxxopts::value(metricsPeriod))
+    ("metrics-binary", "Write the metrics in the columnar binary format",
+     cxxopts::value(metricsBinary))
+    ;
+
+  auto result = options.parse(argc, argv);
+  if (result.count("help")) {
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+
+  config::PTree::setupConfig(configFile, config::Verbosity::QUIET);
+
+  std::cout << "Parameters: " << nlohmann::json(p) << "\n";
+
+  if (!trace.empty())  phylogeny::tracing::start();
+
+  PTree pt;
+
+  std::unique_ptr<phylogeny::MetricsWriter> writer;
+  std::unique_ptr<PTree::Callbacks> observer;
+  if (!metrics.empty()) {
+    using Format = phylogeny::MetricsWriter::Format;
+    writer = std::make_unique<phylogeny::MetricsWriter>(
+               metrics, metricsBinary ? Format::BINARY : Format::CSV);
+    observer = std::make_unique<PTree::Callbacks>(pt, *writer, metricsPeriod);
+    pt.setCallbacks(observer.get());
+  }
+
+  Driver driver (pt, p);
+
+  auto start = Clock::now();
+  std::cout << "Step Species Alive Seconds" << PTree::StatsHeader{} << "\n";
+  driver.run([&] (uint step) {
+    if (period == 0 || (step % period != 0 && step != p.generations)) return;
+    std::cout << step << " " << pt.width() << " " << pt.aliveSpecies().size()
+              << " " << std::chrono::duration<double>(Clock::now() - start)
+                          .count()
+              << pt.stats() << std::endl;
+  });
+
+  const Driver::Stats &s = driver.stats();
+  std::cout << "Matings: " << s.matings << " (" << s.bailouts
+            << " bailed out), births: " << s.births << ", stillborns: "
+            << s.stillborns << ", deaths: " << s.deaths << "\n";
+
+#ifdef WITH_PHASE_TIMINGS
+  pt.dumpTimings(std::cout);
+#endif
+
+  if (!output.empty() && !pt.saveTo(output))
+    utils::doThrow<std::runtime_error>("Failed to save to ", output);
+
+  if (!trace.empty()) {
+    phylogeny::tracing::stop();
+    if (!phylogeny::tracing::writeTo(trace))
+      utils::doThrow<std::runtime_error>("Failed to write trace to ", trace);
+  }
+
+  return 0;
+}
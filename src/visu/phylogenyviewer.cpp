@@ -460,7 +460,11 @@ void PhylogenyViewer_base::changeColorMode(int m) {
 void PhylogenyViewer_base::treeStepped (uint step, const LivingSet &living) {
   updatePens();
 
-  for (Node *n: _items.nodes) n->updateNode(living.find(n->id) != living.end());
+  // Only still-alive species have a moving timeline. The others were taken
+  // care of when they disappeared
+  for (SID sid: living)
+    if (Node *n = _items.nodes.value(sid))  n->updateNode(true);
+
   _items.border->setRadius(step);
   _items.scene->setSceneRect(_items.border->boundingRect());
   makeFit(_config.autofit);
@@ -473,6 +477,17 @@ void PhylogenyViewer_base::treeStepped (uint step, const LivingSet &living) {
   }
 }
 
+void PhylogenyViewer_base::livingSpeciesChanged (const LivingDelta &delta) {
+  for (SID sid: delta.disappeared)
+    if (Node *n = _items.nodes.value(sid))  n->updateNode(false);
+
+  // Species created and extinct within the same step (appeared is sorted)
+  for (SID sid: _newSpecies)
+    if (!std::binary_search(delta.appeared.begin(), delta.appeared.end(), sid))
+      if (Node *n = _items.nodes.value(sid))  n->updateNode(false);
+  _newSpecies.clear();
+}
+
 void PhylogenyViewer_base::genomeEntersEnveloppe (SID sid, GID) {
   const uint K = config::PTree::rsetSize();
   Node *n = _items.nodes.value(sid);
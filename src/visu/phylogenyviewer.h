@@ -33,6 +33,9 @@ protected:
   /// Helper alias to the phylogenic tree's collection of living individuals
   using LivingSet = phylogeny::LivingSet;
 
+  /// Helper alias to the changes in the phylogenic tree's living species
+  using LivingDelta = phylogeny::LivingDelta;
+
   /// Configuration data controlling what to draw and how
   using Config = gui::ViewerConfig;
 
@@ -92,6 +95,10 @@ signals:
   /// \copydetails phylogeny::Callbacks_t::onStepped
   void onTreeStepped (uint step, const LivingSet &living);
 
+  /// \brief Emitted when the tree is stepped, before onTreeStepped
+  /// \copydetails phylogeny::Callbacks_t::onSteppedDelta
+  void onTreeSteppedDelta (uint step, const LivingDelta &delta);
+
   /// Emitted when a species has been added to the tree
   /// \copydetails phylogeny::Callbacks_t::onNewSpecies
   void onNewSpecies (SID pid, SID sid);
@@ -119,6 +126,9 @@ protected slots:
   /// Process a step event (new timestamp/living species)
   void treeStepped (uint step, const LivingSet &living);
 
+  /// Process the changes in the living species (newly alive/extinct)
+  void livingSpeciesChanged (const LivingDelta &delta);
+
   /// Process a enveloppe change event
   void genomeEntersEnveloppe (SID sid, GID gid);
 
@@ -194,6 +204,10 @@ protected:
   /// The view in which the graphics items reside
   QGraphicsView *_view;
 
+  /// Species created since the last step (those already extinct by then are
+  /// in neither the living set nor its delta)
+  std::vector<SID> _newSpecies;
+
   /// Constructor delegate called by template instantiations
   void constructorDelegate (uint steps,
                             Direction direction = Direction::LeftToRight);
@@ -291,6 +305,7 @@ public:
     Node *parent = (pid != SID::INVALID) ? _items.nodes[pid] : nullptr;
     const auto &pn = *_ptree.nodeAt(sid);
     Builder::addSpecies(parent, pn, c);
+    _newSpecies.push_back(sid);
     Builder::updateLayout(_items);
     _items.border->setEmpty(false);
     _view->update();
@@ -315,8 +330,9 @@ protected:
     std::vector<GENOME> genomes;
 
     data.append(gn.computeTooltip());
-    for (const auto &ep: n.rset) {
-      data.append(dumpEnveloppePoint(ep));
+    for (uint i=0; i<n.rsetSize(); i++) {
+      const auto &ep = (*n.rset)[i];
+      data.append(dumpEnveloppePoint(ep, *n.userData[i]));
       genomes.push_back(ep.genome);
     }
 
@@ -339,14 +355,16 @@ private:
   }
 
   /// \returns a description of the data contained by this enveloppe point
-  QString dumpEnveloppePoint (const typename PTree::Node::Representative &ep) {
+  /// (and its user data \p ud)
+  QString dumpEnveloppePoint (const typename PTree::Node::Representative &ep,
+                              const typename PTree::UserData &ud) {
     QString s;
     s += "Insertion: ";
     s += QString::number(ep.timestamp);
     s += "\nGenome: ";
     s += QString::fromStdString(nlohmann::json(ep.genome).dump(2));
     s += "\nUser data: ";
-    s += QString::fromStdString(nlohmann::json(*ep.userData).dump(2));
+    s += QString::fromStdString(nlohmann::json(ud).dump(2));
     s += "\n";
     return s;
   }
@@ -376,6 +394,9 @@ struct phylogeny::Callbacks_t<phylogeny::PhylogeneticTree<GENOME, UDATA>> {
   /// Helper alias to a collection of still-alive species
   using LivingSet = phylogeny::LivingSet;
 
+  /// Helper alias to the changes in the collection of still-alive species
+  using LivingDelta = phylogeny::LivingDelta;
+
   /// Creates a callback object associated with a specific viewer
   Callbacks_t (PV *v) : viewer(v) {}
 
@@ -388,6 +409,15 @@ struct phylogeny::Callbacks_t<phylogeny::PhylogeneticTree<GENOME, UDATA>> {
     emit viewer->onTreeStepped(step, living);
   }
 
+  /// Notify both the viewer and the outside world of the species that
+  /// appeared/disappeared since the associated tree's previous step
+  ///
+  /// \copydetails phylogeny::Callbacks_t::onSteppedDelta
+  void onSteppedDelta (uint step, const LivingDelta &delta) {
+    viewer->livingSpeciesChanged(delta);
+    emit viewer->onTreeSteppedDelta(step, delta);
+  }
+
   /// Notify both the viewer and the outside world that a new species has been
   /// added to the associated tree
   ///
@@ -174,7 +174,7 @@ public:
       sid(QString::number(std::underlying_type<SID>::type(id))),
       path(nullptr), timeline(nullptr) {
 
-    rset = n.rset.size();
+    rset = n.rsetSize();
     children = n.children().size();
 
     _alive = false;
@@ -38,6 +38,7 @@ int run(int argc, char *argv[]) {
   std::string layoutStr = "LR";
 
   std::string customColors;
+  bool lazy = true;
 
   cxxopts::Options options("PTreeViewer", "Loads and displays a phenotypic tree"
                            " for \"" + utils::className<GENOME>()
@@ -66,6 +67,8 @@ int run(int argc, char *argv[]) {
      cxxopts::value(layoutStr))
     ("colors", "Custom colors for species tracking ID1:Color1 ID2:Color2 ...",
      cxxopts::value(customColors))
+    ("lazy", "Whether or not to only decode genomes when inspecting a species",
+     cxxopts::value(lazy)->default_value("true"))
     ;
 
   auto result = options.parse(argc, argv);
@@ -126,7 +129,8 @@ int run(int argc, char *argv[]) {
   QApplication a(argc, argv);
   setlocale(LC_NUMERIC,"C");
 
-  PTree pt = PTree::readFrom(ptreeFile);
+  PTree pt = PTree::readFrom(ptreeFile, lazy ? phylogeny::LoadMode::LAZY
+                                             : phylogeny::LoadMode::EAGER);
 
   auto layoutDir = dirFromStr.value(QString::fromStdString(layoutStr));
   PViewer pv (nullptr, pt, layoutDir, config);